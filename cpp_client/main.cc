@@ -96,46 +96,30 @@ public:
                 case 'D': {
                     int off = 0;
                     for (DatumType type: types) {
-                        bool is_null = *((bool*)(msg.data() + off));
-                        off += sizeof(bool);
-                        if (is_null) {
-                            std::cout << "null,";
-                        } else {
-                            switch (type) {
-                                case DatumType::Int8: {
-                                    int64_t value = *((int64_t*)(msg.data() + off));
-                                    off += sizeof(int64_t);
-                                    std::cout << value << ",";
-                                    break;
+                        Datum d(msg, &off, type);
+                        switch (d.Type()) {
+                            case DatumType::Null:
+                                std::cout << "null,";
+                                break;
+                            case DatumType::Int8:
+                                std::cout << d.AsInt8() << ",";
+                                break;
+                            case DatumType::Float4:
+                                std::cout << d.AsFloat4() << ",";
+                                break;
+                            case DatumType::Text:
+                                std::cout << d.TextView() << ",";
+                                break;
+                            case DatumType::Bool:
+                                if (d.AsBool()) {
+                                    std::cout << "true,";
+                                } else {
+                                    std::cout << "false,";
                                 }
-                                case DatumType::Float4: {
-                                    float value = *((float*)(msg.data() + off));
-                                    off += sizeof(float);
-                                    std::cout << value << ",";
-                                    break;
-                                }
-                                case DatumType::Text: {
-                                    int len = *((int*)(msg.data() + off));
-                                    off += sizeof(int);
-                                    std::string s = msg.substr(off, len);
-                                    off += len;
-                                    std::cout << s << ",";
-                                    break;
-                                }
-                                case DatumType::Bool: {
-                                    bool value = *((bool*)(msg.data() + off));
-                                    off += sizeof(bool);
-                                    if (value) {
-                                        std::cout << "true,";
-                                    } else {
-                                        std::cout << "false,";
-                                    }
-                                    break;
-                                }
-                                default:
-                                    std::cout << "[Error],";
-                                    break;
-                            }
+                                break;
+                            default:
+                                std::cout << "[Error],";
+                                break;
                         }
                     }
                     std::cout << std::endl;
@@ -46,6 +46,18 @@ func PrintResult(readers []wsldb.Reader) {
     }
 }
 
+//collects the single int8 column of each row
+func Predictions(readers []wsldb.Reader) []int64 {
+    results := make([]int64, 0)
+    for _, reader := range readers {
+        for row := 0; row < reader.RowCount; row++ {
+            if wsldb.NextType(&reader) == wsldb.Int8 {
+                results = append(results, wsldb.NextInt8(&reader))
+            }
+        }
+    }
+    return results
+}
 
 func main() {
     conn := wsldb.ConnectToServer("localhost:3000")
@@ -66,8 +78,14 @@ func main() {
     f2.Read(count_bytes) //pixels per row
     f2.Read(count_bytes) //pixels per col
 
+    //enough rows for the predictions to span several batches
+    rows := 10
+    if count < rows {
+        rows = count
+    }
+
     query := "insert into mnist (label, data) values "
-    for i := 0; i < 10; i++ {
+    for i := 0; i < rows; i++ {
         label := make([]byte, 1)
         f1.Read(label)
         label_as_str := strconv.Itoa(int(label[0]))
@@ -78,7 +96,7 @@ func main() {
 
         query += "(" + label_as_str + ",  '\\x" + pixels_as_str + "')"
 
-        if i != count - 1 {
+        if i != rows - 1 {
             query += ", "
         }
     }
@@ -88,6 +106,19 @@ func main() {
     wsldb.ExecuteQuery(conn, query)
     //PrintResult(wsldb.ExecuteQuery(conn, "select label, data from mnist where _rowid < 10;"))
     PrintResult(wsldb.ExecuteQuery(conn, "select label, my_model(data) from mnist where _rowid < 10;"))
+
+    //predictions must not depend on how rows are split into batches, including a predict in a
+    //correlated subquery that runs while the outer query's batch is in progress
+    wsldb.ExecuteQuery(conn, "set predict_batch_size = 1;")
+    single := Predictions(wsldb.ExecuteQuery(conn, "select my_model(data) from mnist;"))
+    wsldb.ExecuteQuery(conn, "set predict_batch_size = 3;")
+    batched := Predictions(wsldb.ExecuteQuery(conn, "select my_model(data) from mnist;"))
+    correlated := Predictions(wsldb.ExecuteQuery(conn, "select (select my_model(m2.data) from mnist as m2 where m2._rowid = m1._rowid) from mnist as m1;"))
+    if fmt.Sprint(single) == fmt.Sprint(batched) && fmt.Sprint(single) == fmt.Sprint(correlated) {
+        fmt.Printf("batched predictions match\n")
+    } else {
+        fmt.Printf("batched predictions differ: %v %v %v\n", single, batched, correlated)
+    }
     //PrintResult(wsldb.ExecuteQuery(conn, "select label = my_model(data) from mnist where _rowid < 10;"))
     wsldb.ExecuteQuery(conn, "drop model my_model;")
     wsldb.ExecuteQuery(conn, "drop table mnist;")
@@ -205,7 +205,7 @@ func ProcessResponse(conn *net.TCPConn, buf []byte, rd RowDescription, reader Re
 
                 var size int
                 size, off = ReadSize(msg, off)
-                name := string(buf[off: off + size])
+                name := string(msg[off: off + size])
                 off += size
 
                 rd.names = append(rd.names, name)
@@ -1,8 +1,12 @@
 #pragma once
 
+#include <atomic>
+#include <cstring>
+#include <ctime>
+#include <new>
 #include <string>
+#include <string_view>
 #include <vector>
-#include <cstring>
 
 namespace wsldb {
 
@@ -18,47 +22,75 @@ enum class DatumType {
     Timestamp
 };
 
+//Immutable bytes of a text or bytea datum.  Datums share the buffer when copied, so copying a
+//row of strings only bumps reference counts.  The bytes are stored directly after the header
+struct DatumText {
+    std::atomic<int> refs;
+    size_t size;
+
+    const char* Bytes() const {
+        return (const char*)(this + 1);
+    }
+
+    static DatumText* New(const char* bytes, size_t size) {
+        DatumText* text = new (::operator new(sizeof(DatumText) + size)) DatumText();
+        text->refs.store(1, std::memory_order_relaxed);
+        text->size = size;
+        memcpy((char*)(text + 1), bytes, size);
+        return text;
+    }
+
+    void Ref() {
+        refs.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void Unref() {
+        if (refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            this->~DatumText();
+            ::operator delete(this);
+        }
+    }
+};
+
+//A type tag and an 8 byte value.  Int8, Float4, Bool and Timestamp values are stored inline, and
+//text/bytea hold a pointer to a shared DatumText (null for an empty string).  TextView() borrows
+//the bytes without copying them - the view is valid as long as the datum (or a copy of it) is
 class Datum {
 public:
     Datum(DatumType type, const std::string& lexeme) {
         type_ = type;
         switch (type) {
             case DatumType::Int8: {
-                int64_t value = std::stol(lexeme);
-                data_.append((char*)&value, sizeof(int64_t));
+                value_.int8_ = std::stol(lexeme);
                 break;
             }
             case DatumType::Float4: {
-                float value = std::stof(lexeme);
-                data_.append((char*)&value, sizeof(float));
+                value_.float4_ = std::stof(lexeme);
                 break;
             }
             case DatumType::Text: {
-                data_ += lexeme;
+                SetText(lexeme.data(), lexeme.size());
                 break;
             }
             case DatumType::Bytea: {
+                std::string bytes;
                 for (size_t i = 2 /*skip \x*/; i < lexeme.size(); i += 2) {
                     std::string pair = lexeme.substr(i, 2);
                     char byte = (char)strtol(pair.c_str(), NULL, 16);
-                    data_.append((char*)&byte, sizeof(char));
+                    bytes.append((char*)&byte, sizeof(char));
                 }
+                SetText(bytes.data(), bytes.size());
                 break;
             }
             case DatumType::Bool: {
-                bool value = false;
-                if (lexeme.compare("true") == 0) {
-                    value = true;
-                }
-                data_.append((char*)&value, sizeof(bool));
+                value_.bool_ = lexeme.compare("true") == 0;
                 break;
             }
             case DatumType::Timestamp: {
                 struct tm tm;
                 memset(&tm, 0, sizeof(struct tm));
                 if (strptime(lexeme.c_str(), "%Y-%m-%d %H:%M:%S", &tm)) {
-                    time_t t = mktime(&tm);
-                    data_.append((char*)&t, sizeof(time_t));
+                    value_.timestamp_ = mktime(&tm);
                 } //TODO: how to retport error???
                 break;
             }
@@ -73,46 +105,35 @@ public:
     }
 
     //type is the expected datum type based on schema, not the actual type (which may be a null)
-    Datum(const std::string& buf, int* off, DatumType type) {
+    Datum(std::string_view buf, int* off, DatumType type) {
         bool is_null = *((bool*)(buf.data() + *off));
         *off += sizeof(bool);
 
         if (is_null) {
             type_ = DatumType::Null;
-            data_ = "";
             return;
         }
 
         type_ = type;
         switch (type) {
-            case DatumType::Int8: {
-                data_.append((char*)(buf.data() + *off), sizeof(int64_t));
-                *off += sizeof(int64_t);
-                break;
-            }
-            case DatumType::Float4: {
-                data_.append((char*)(buf.data() + *off), sizeof(float));
-                *off += sizeof(float);
+            case DatumType::Int8:
+            case DatumType::Float4:
+            case DatumType::Bool:
+            case DatumType::Timestamp: {
+                size_t size = FixedSize(type);
+                memcpy(&value_, buf.data() + *off, size);
+                *off += size;
                 break;
             }
             case DatumType::Bytea:
             case DatumType::Text: {
-                int size = *((int*)(buf.data() + *off));
+                int size;
+                memcpy(&size, buf.data() + *off, sizeof(int));
                 *off += sizeof(int);
-                data_.append(buf.data() + *off, size);
+                SetText(buf.data() + *off, size);
                 *off += size;
                 break;
             }
-            case DatumType::Bool: {
-                data_.append((char*)(buf.data() + *off), sizeof(bool));
-                *off += sizeof(bool);
-                break;
-            }
-            case DatumType::Timestamp: {
-                data_.append((char*)(buf.data() + *off), sizeof(time_t));
-                *off += sizeof(time_t);
-                break;
-            }
             default:
                 //std::cout << "invalid buffer data for initializing datum: " << TokenTypeToString(type) << std::endl;
                 break;
@@ -121,29 +142,81 @@ public:
 
     Datum() {
         type_ = DatumType::Null;
-        data_ = "";
     }
 
     Datum(int i): Datum(static_cast<int64_t>(i)) {}
 
     Datum(int64_t i) {
         type_ = DatumType::Int8;
-        data_.append((char*)&i, sizeof(int64_t));
+        value_.int8_ = i;
     }
 
     Datum(float f) {
         type_ = DatumType::Float4;
-        data_.append((char*)&f, sizeof(float));
+        value_.float4_ = f;
     }
 
     Datum(bool b) {
         type_ = DatumType::Bool;
-        data_.append((char*)&b, sizeof(bool));
+        value_.bool_ = b;
     }
 
     Datum(const std::string& s) {
         type_ = DatumType::Text;
-        data_ = s;
+        SetText(s.data(), s.size());
+    }
+
+    //text or bytea datum holding a copy of the given bytes
+    static Datum FromBytes(DatumType type, const char* bytes, size_t size) {
+        Datum d;
+        d.type_ = type;
+        d.SetText(bytes, size);
+        return d;
+    }
+
+    static Datum FromTimestamp(time_t t) {
+        Datum d;
+        d.type_ = DatumType::Timestamp;
+        d.value_.timestamp_ = t;
+        return d;
+    }
+
+    Datum(const Datum& d) {
+        type_ = d.type_;
+        value_ = d.value_;
+        if (HasText() && value_.text_)
+            value_.text_->Ref();
+    }
+
+    Datum(Datum&& d) noexcept {
+        type_ = d.type_;
+        value_ = d.value_;
+        d.type_ = DatumType::Null;
+        d.value_.int8_ = 0;
+    }
+
+    Datum& operator=(const Datum& d) {
+        if (d.HasText() && d.value_.text_)
+            d.value_.text_->Ref();
+        Release();
+        type_ = d.type_;
+        value_ = d.value_;
+        return *this;
+    }
+
+    Datum& operator=(Datum&& d) noexcept {
+        if (this != &d) {
+            Release();
+            type_ = d.type_;
+            value_ = d.value_;
+            d.type_ = DatumType::Null;
+            d.value_.int8_ = 0;
+        }
+        return *this;
+    }
+
+    ~Datum() {
+        Release();
     }
 
     bool IsType(DatumType type) const {
@@ -154,58 +227,82 @@ public:
         return type_;
     }
 
-    std::string Serialize() const {
-        std::string result;
-        bool is_null = false;
+    //appends the serialized datum to out, avoiding a temporary string per datum when building rows
+    void SerializeTo(std::string* out) const {
+        bool is_null = type_ == DatumType::Null;
+        out->append((char*)&is_null, sizeof(bool));
 
         //if null, don't include data (since it won't be valid anyway)
-        if (type_ == DatumType::Null) {
-            is_null = true;
-            result.append((char*)&is_null, sizeof(bool));
-            return result;
-        }
-
-        result.append((char*)&is_null, sizeof(bool));
+        if (is_null)
+            return;
 
-        if (type_ == DatumType::Text || type_ == DatumType::Bytea) {
-            int size = data_.size();
-            result.append((char*)&size, sizeof(int));
+        if (HasText()) {
+            std::string_view text = TextView();
+            int size = text.size();
+            out->append((char*)&size, sizeof(int));
+            out->append(text.data(), text.size());
+            return;
         }
-            
-        result += data_;
 
+        out->append((const char*)&value_, FixedSize(type_));
+    }
+
+    std::string Serialize() const {
+        std::string result;
+        SerializeTo(&result);
         return result;
     }
 
     std::string AsString() const { //TODO: should remove this since AsText is used now
-        return data_;
+        return std::string(TextView());
     }
 
     std::string AsText() const {
-        return data_;
+        return std::string(TextView());
     }
 
+    //bytes of text and bytea datums without copying them
+    std::string_view TextView() const {
+        if (!HasText() || !value_.text_)
+            return std::string_view();
+        return std::string_view(value_.text_->Bytes(), value_.text_->size);
+    }
+
+    //raw bytes of the value - the inline bytes for fixed width types
     std::string Data() const {
-        return data_;
+        if (HasText())
+            return AsText();
+        return std::string((const char*)&value_, FixedSize(type_));
+    }
+
+    //heap bytes owned by the datum beyond its inline value
+    size_t DataSize() const {
+        if (HasText() && value_.text_)
+            return sizeof(DatumText) + value_.text_->size;
+        return 0;
     }
 
     int64_t AsInt8() const {
-        return *((int64_t*)(data_.data()));
+        return value_.int8_;
     }
 
     float AsFloat4() const {
-        return *((float*)(data_.data()));
+        return value_.float4_;
     }
 
     bool AsBool() const {
-        return *((bool*)(data_.data()));
+        return value_.bool_;
+    }
+
+    time_t AsTimestamp() const {
+        return value_.timestamp_;
     }
 
     std::string AsBytea() const {
-        return data_;
+        return std::string(TextView());
     }
 
-    Datum operator+(const Datum& d) {
+    Datum operator+(const Datum& d) const {
         if (TypeIsInteger(this->Type()) && TypeIsInteger(d.Type())) {
             return Datum(static_cast<int64_t>(this->AsInt8() + d.AsInt8()));
         }
@@ -218,7 +315,7 @@ public:
         return *this;
     }
 
-    Datum operator-(const Datum& d) {
+    Datum operator-(const Datum& d) const {
         if (TypeIsInteger(this->Type()) && TypeIsInteger(d.Type())) {
             return Datum(static_cast<int64_t>(this->AsInt8() - d.AsInt8()));
         }
@@ -231,7 +328,7 @@ public:
         return *this;
     }
 
-    Datum operator*(const Datum& d) {
+    Datum operator*(const Datum& d) const {
         if (TypeIsInteger(this->Type()) && TypeIsInteger(d.Type())) {
             return Datum(static_cast<int64_t>(this->AsInt8() * d.AsInt8()));
         }
@@ -244,7 +341,7 @@ public:
         return *this;
     }
 
-    Datum operator/(const Datum& d) {
+    Datum operator/(const Datum& d) const {
         if (TypeIsInteger(this->Type()) && TypeIsInteger(d.Type())) {
             return Datum(static_cast<int64_t>(this->AsInt8() / d.AsInt8()));
         }
@@ -257,7 +354,7 @@ public:
         return *this;
     }
 
-    bool operator==(const Datum& d) {
+    bool operator==(const Datum& d) const {
         switch (type_) {
             case DatumType::Int8:
             case DatumType::Float4:
@@ -265,7 +362,7 @@ public:
             case DatumType::Bool:
                 return AsBool() - d.AsBool() == 0;
             case DatumType::Text:
-                return AsString().compare(d.AsString()) == 0;
+                return TextView() == d.TextView();
             default:
                 //std::cout << "invalid type for comparing data: " << TokenTypeToString(type_) << std::endl;
                 break;
@@ -273,11 +370,11 @@ public:
         return false;
     }
 
-    bool operator!=(const Datum& d) {
+    bool operator!=(const Datum& d) const {
         return !(*this == d);
     }
 
-    bool operator<(const Datum& d) {
+    bool operator<(const Datum& d) const {
         switch (type_) {
             case DatumType::Int8:
             case DatumType::Float4:
@@ -285,7 +382,7 @@ public:
             case DatumType::Bool:
                 return AsBool() - d.AsBool() < 0;
             case DatumType::Text:
-                return AsString().compare(d.AsString()) < 0;
+                return TextView() < d.TextView();
             default:
                 //std::cout << "invalid type for comparing data: " << TokenTypeToString(type_) << std::endl;
                 break;
@@ -293,31 +390,31 @@ public:
         return false;
     }
 
-    bool operator<=(const Datum& d) {
+    bool operator<=(const Datum& d) const {
         return *this == d || *this < d;
     }
 
-    bool operator>=(const Datum& d) {
+    bool operator>=(const Datum& d) const {
         return !(*this < d);
     }
 
-    bool operator>(const Datum& d) {
+    bool operator>(const Datum& d) const {
         return !(*this <= d);
     }
 
-    bool operator||(const Datum& d) {
+    bool operator||(const Datum& d) const {
         return (*this).AsBool() || d.AsBool();
     }
 
-    bool operator&&(const Datum& d) {
+    bool operator&&(const Datum& d) const {
         return (*this).AsBool() && d.AsBool();
     }
 
 public:
     static std::string SerializeData(const std::vector<Datum>& data) {
         std::string value;
-        for (Datum d: data) {
-            value += d.Serialize();
+        for (const Datum& d: data) {
+            d.SerializeTo(&value);
         }
         return value;
     }
@@ -348,7 +445,7 @@ static bool TypeIsNumeric(DatumType type) {
            type == DatumType::Float4;
 }
 
-static bool CastInt8(Datum d, DatumType to, Datum* result) {
+static bool CastInt8(const Datum& d, DatumType to, Datum* result) {
     switch (to) {
         case DatumType::Int8:
             *result = Datum(d.AsInt8());
@@ -370,7 +467,7 @@ static bool CastInt8(Datum d, DatumType to, Datum* result) {
     }
 }
 
-static bool CastFloat4(Datum d, DatumType to, Datum* result) {
+static bool CastFloat4(const Datum& d, DatumType to, Datum* result) {
     switch (to) {
         case DatumType::Int8:
             *result = Datum(int(d.AsFloat4()));
@@ -390,7 +487,7 @@ static bool CastFloat4(Datum d, DatumType to, Datum* result) {
     }
 }
 
-static bool CastText(Datum d, DatumType to, Datum* result) {
+static bool CastText(const Datum& d, DatumType to, Datum* result) {
     switch (to) {
         case DatumType::Text:
             *result = Datum(d.AsText());
@@ -408,7 +505,7 @@ static bool CastText(Datum d, DatumType to, Datum* result) {
     }
 }
 
-static bool CastBool(Datum d, DatumType to, Datum* result) {
+static bool CastBool(const Datum& d, DatumType to, Datum* result) {
     switch (to) {
         case DatumType::Int8:
             *result = Datum(int(d.AsBool()));
@@ -445,7 +542,7 @@ static bool CanCast(DatumType from, DatumType to) {
     }
 }
 
-static bool Cast(Datum d, DatumType to, Datum* result) {
+static bool Cast(const Datum& d, DatumType to, Datum* result) {
     switch (d.type_) {
         case DatumType::Int8:
             return CastInt8(d, to, result);
@@ -467,9 +564,41 @@ static bool TypeIsInteger(DatumType type) {
     return type == DatumType::Int8;
 }
 
+private:
+    bool HasText() const {
+        return type_ == DatumType::Text || type_ == DatumType::Bytea;
+    }
+
+    static size_t FixedSize(DatumType type) {
+        switch (type) {
+            case DatumType::Int8:       return sizeof(int64_t);
+            case DatumType::Float4:     return sizeof(float);
+            case DatumType::Bool:       return sizeof(bool);
+            case DatumType::Timestamp:  return sizeof(time_t);
+            default:                    return 0;
+        }
+    }
+
+    void SetText(const char* bytes, size_t size) {
+        value_.text_ = size > 0 ? DatumText::New(bytes, size) : nullptr;
+    }
+
+    void Release() {
+        if (HasText() && value_.text_)
+            value_.text_->Unref();
+    }
+
 private:
     DatumType type_;
-    std::string data_;
+    union {
+        int64_t int8_;
+        float float4_;
+        bool bool_;
+        time_t timestamp_;
+        DatumText* text_;
+    } value_ {0};
 };
 
+static_assert(sizeof(Datum) == 16, "datums should stay two words");
+
 }
@@ -3,7 +3,14 @@
 
 namespace wsldb {
 
+//top level statements start with no scans - subqueries go through VerifyStmt, so column marks made
+//from inside a subquery still reach the scans of the enclosing query
 Status Analyzer::Verify(Stmt* stmt, AttributeSet** working_attrs) {
+    table_cols_.clear();
+    return VerifyStmt(stmt, working_attrs);
+}
+
+Status Analyzer::VerifyStmt(Stmt* stmt, AttributeSet** working_attrs) {
     switch (stmt->Type()) {
         case StmtType::Create:
             return CreateVerifier((CreateStmt*)stmt); //C-style cast since dynamic_cast requires rtti, but rocksdb not currently compiled with rtti
@@ -25,13 +32,19 @@ Status Analyzer::Verify(Stmt* stmt, AttributeSet** working_attrs) {
             return CreateModelVerifier((CreateModelStmt*)stmt);
         case StmtType::DropModel:
             return DropModelVerifier((DropModelStmt*)stmt);
+        case StmtType::CopyFrom:
+            return CopyFromVerifier((CopyFromStmt*)stmt);
+        case StmtType::CopyTo:
+            return CopyToVerifier((CopyToStmt*)stmt);
+        case StmtType::Set:
+            return SetVerifier((SetStmt*)stmt);
         default:
             return Status(false, "Execution Error: Invalid statement type");
     }
 }
 
 Status Analyzer::CreateVerifier(CreateStmt* stmt) { 
-    Table* schema;
+    std::shared_ptr<const Table> schema;
     Status s = GetSchema(stmt->target_.lexeme, &schema);
     if (s.Ok()) {
         return Status(false, "Error: Table '" + stmt->target_.lexeme + "' already exists");
@@ -91,6 +104,9 @@ Status Analyzer::UpdateVerifier(UpdateStmt* stmt) {
             return s;
     }
 
+    //updated rows are written back whole
+    MarkAllColumnsUsed(working_attrs);
+
     scopes_.push_back(working_attrs);
     for (Expr* e: stmt->assigns_) {
         Attribute attr;
@@ -112,6 +128,9 @@ Status Analyzer::DeleteVerifier(DeleteStmt* stmt) {
             return s;
     }
 
+    //keys of every index are built from the deleted row
+    MarkAllColumnsUsed(working_attrs);
+
     return Status(); 
 }
 
@@ -180,35 +199,76 @@ Status Analyzer::DropModelVerifier(DropModelStmt* stmt) {
     return Status(); 
 }
 
+Status Analyzer::CopyFromVerifier(CopyFromStmt* stmt) {
+    return GetSchema(stmt->target_.lexeme, &stmt->schema_);
+}
+
+Status Analyzer::CopyToVerifier(CopyToStmt* stmt) {
+    AttributeSet* working_attrs;
+    return SelectVerifier(stmt->query_, &working_attrs);
+}
+
+Status Analyzer::SetVerifier(SetStmt* stmt) {
+    const std::string& name = stmt->name_.lexeme;
+    if (name != "memory_budget" && name != "predict_batch_size")
+        return Status(false, "Analysis Error: Unrecognized setting '" + name + "'");
+
+    if (stmt->value_.lexeme.size() > 18 || std::stoll(stmt->value_.lexeme) <= 0)
+        return Status(false, "Analysis Error: '" + name + "' must be a positive number of " + (name == "memory_budget" ? "bytes" : "rows"));
+
+    return Status();
+}
+
 /*
  * Expression Verifiers
  */
 
 Status Analyzer::Verify(Expr* expr, Attribute* attr) {
+    Status s;
     switch (expr->Type()) {
         case ExprType::Literal:
-            return VerifyLiteral((Literal*)expr, attr);
+            s = VerifyLiteral((Literal*)expr, attr);
+            break;
         case ExprType::Binary:
-            return VerifyBinary((Binary*)expr, attr);
+            s = VerifyBinary((Binary*)expr, attr);
+            break;
         case ExprType::Unary:
-            return VerifyUnary((Unary*)expr, attr);
+            s = VerifyUnary((Unary*)expr, attr);
+            break;
         case ExprType::ColRef:
-            return VerifyColRef((ColRef*)expr, attr);
+            s = VerifyColRef((ColRef*)expr, attr);
+            break;
         case ExprType::ColAssign:
-            return VerifyColAssign((ColAssign*)expr, attr);
+            s = VerifyColAssign((ColAssign*)expr, attr);
+            break;
         case ExprType::Call:
-            return VerifyCall((Call*)expr, attr);
+            s = VerifyCall((Call*)expr, attr);
+            break;
         case ExprType::IsNull:
-            return VerifyIsNull((IsNull*)expr, attr);
+            s = VerifyIsNull((IsNull*)expr, attr);
+            break;
         case ExprType::ScalarSubquery:
-            return VerifyScalarSubquery((ScalarSubquery*)expr, attr);
+            s = VerifyScalarSubquery((ScalarSubquery*)expr, attr);
+            break;
         case ExprType::Predict:
-            return VerifyPredict((Predict*)expr, attr);
+            s = VerifyPredict((Predict*)expr, attr);
+            break;
         case ExprType::Cast:
-            return VerifyCast((Cast*)expr, attr);
+            s = VerifyCast((Cast*)expr, attr);
+            break;
         default:
             return Status(false, "Execution Error: Invalid expression type");
     }
+
+    expr->datum_type_ = attr->type;
+    return s;
+}
+
+//Compiles an expression that is evaluated for every row.  Must be called after the expression is
+//verified, since instructions are specialized on the types the analyzer found
+void Analyzer::Compile(Expr* expr) {
+    if (!expr->program_)
+        expr->program_ = Program::Compile(expr);
 }
 
 Status Analyzer::VerifyLiteral(Literal* expr, Attribute* attr) { 
@@ -261,7 +321,12 @@ Status Analyzer::VerifyBinary(Binary* expr, Attribute* attr) {
             if (!(Datum::TypeIsNumeric(left_attr.type) && Datum::TypeIsNumeric(right_attr.type))) {
                 return Status(false, "Error: The '" + expr->op_.lexeme + "' operator operands must both be a numeric type");
             } 
-            *attr = Attribute("", expr->ToString(), left_attr.type);
+            //mixed operands are evaluated as floats, so the result is only an integer if both are
+            if (Datum::TypeIsInteger(left_attr.type) && Datum::TypeIsInteger(right_attr.type)) {
+                *attr = Attribute("", expr->ToString(), left_attr.type);
+            } else {
+                *attr = Attribute("", expr->ToString(), DatumType::Float4);
+            }
             break;
         case TokenType::Similar:
         case TokenType::Like:
@@ -310,15 +375,20 @@ Status Analyzer::VerifyUnary(Unary* expr, Attribute* attr) {
 Status Analyzer::VerifyColRef(ColRef* expr, Attribute* attr) { 
     {
         Status s;
-        int dummy_idx;
+        int idx;
         for (size_t i = 0; i < scopes_.size(); i++) {
             AttributeSet* as = scopes_.rbegin()[i];
             s = as->ResolveColumnTable(&expr->col_);
             if (!s.Ok()) return s;
 
-            s = as->GetAttribute(&expr->col_, attr, &dummy_idx);
-            if (s.Ok())
+            s = as->GetAttribute(&expr->col_, attr, &idx);
+            if (s.Ok()) {
+                expr->depth_ = i;
+                expr->idx_ = idx;
+                expr->scope_ = as;
+                MarkColumnUsed(as, idx);
                 break;
+            }
         }
         if (!s.Ok())
             return s;
@@ -337,17 +407,21 @@ Status Analyzer::VerifyColAssign(ColAssign* expr, Attribute* attr) {
 
     {
         Status s;
-        int dummy_idx;
+        int idx;
         for (size_t i = 0; i < scopes_.size(); i++) {
             AttributeSet* as = scopes_.rbegin()[i];
             s = as->ResolveColumnTable(&expr->col_);
             if (!s.Ok()) return s;
 
-            s = as->GetAttribute(&expr->col_, attr, &dummy_idx);
+            s = as->GetAttribute(&expr->col_, attr, &idx);
             if (s.Ok()) {
                 s = as->PassesConstraintChecks(&expr->col_, right_attr.type);
                 if (!s.Ok()) return s;
 
+                expr->depth_ = i;
+                expr->idx_ = idx;
+                expr->scope_ = as;
+                MarkColumnUsed(as, idx);
                 break;
             }
         }
@@ -372,6 +446,9 @@ Status Analyzer::VerifyCall(Call* expr, Attribute* attr) {
         }
     }
 
+    expr->arg_type_ = arg_attr.type;
+    aggs_.push_back(expr);
+
     switch (expr->fcn_.type) {
         case TokenType::Avg:
             //TODO: need to think about how we want to deal with integer division
@@ -412,7 +489,7 @@ Status Analyzer::VerifyIsNull(IsNull* expr, Attribute* attr) {
 Status Analyzer::VerifyScalarSubquery(ScalarSubquery* expr, Attribute* attr) { 
     AttributeSet* working_attrs;
     {
-        Status s = Verify(expr->stmt_, &working_attrs);
+        Status s = VerifyStmt(expr->stmt_, &working_attrs);
         if (!s.Ok())
             return s;
     }
@@ -435,6 +512,8 @@ Status Analyzer::VerifyPredict(Predict* expr, Attribute* attr) {
         *attr = Attribute("", expr->ToString(), DatumType::Int8); //temp to test mnist
     }
 
+    predicts_.push_back(expr);
+
     {
         std::string serialized_model;
         Status s = (*txn_)->Get(Storage::Models(), expr->model_name_.lexeme, &serialized_model);
@@ -514,6 +593,8 @@ Status Analyzer::VerifyTable(TableScan* scan, AttributeSet** working_attrs) {
 
     *working_attrs = scan->table_->MakeAttributeSet(scan->ref_name_);
     scan->output_attrs_ = *working_attrs;
+    scan->used_cols_.assign(scan->table_->attrs_.size(), false);
+    table_cols_[*working_attrs].push_back({scan, 0});
 
     return Status();
 }
@@ -525,6 +606,8 @@ Status Analyzer::VerifySelectScan(SelectScan* scan, AttributeSet** working_attrs
            return s; 
     }
 
+    scan->scan_ = ChooseJoin(scan->scan_);
+
     scopes_.push_back(*working_attrs);
 
     {
@@ -536,11 +619,15 @@ Status Analyzer::VerifySelectScan(SelectScan* scan, AttributeSet** working_attrs
         if (attr.type != DatumType::Bool) {
             return Status(false, "Analysis Error: where clause expression must evaluate to true or false");
         }
+        Compile(scan->expr_);
     }
     scan->output_attrs_ = *working_attrs;
 
     scopes_.pop_back();
 
+    if (scan->scan_->Type() == ScanType::Table)
+        ChooseIndex((TableScan*)scan->scan_, scan->expr_);
+
     return Status();
 }
 
@@ -561,6 +648,14 @@ Status Analyzer::Verify(ProductScan* scan, AttributeSet** working_attrs) {
         bool has_duplicate_tables;
         *working_attrs = new AttributeSet(left_attrs, right_attrs, &has_duplicate_tables);
         scan->output_attrs_ = *working_attrs;
+
+        std::vector<std::pair<TableScan*, int>>& cols = table_cols_[*working_attrs];
+        for (const std::pair<TableScan*, int>& p: table_cols_[left_attrs]) {
+            cols.push_back(p);
+        }
+        for (const std::pair<TableScan*, int>& p: table_cols_[right_attrs]) {
+            cols.push_back({p.first, p.second + (int)left_attrs->AttributeCount()});
+        }
         if (has_duplicate_tables)
             return Status(false, "Error: Two tables cannot have the same name.  Use an alias to rename one or both tables");
     }
@@ -585,6 +680,7 @@ Status Analyzer::Verify(OuterSelectScan* scan, AttributeSet** working_attrs) {
         if (attr.type != DatumType::Bool) {
             return Status(false, "Analysis Error: where clause expression must evaluate to true or false");
         }
+        Compile(scan->expr_);
     }
 
     scan->output_attrs_ = *working_attrs;
@@ -594,6 +690,10 @@ Status Analyzer::Verify(OuterSelectScan* scan, AttributeSet** working_attrs) {
 }
 
 Status Analyzer::Verify(ProjectScan* scan, AttributeSet** working_attrs) {
+    //only predicts in this projection are batched - any found in subqueries or the input scan are discarded
+    std::vector<Predict*> old_predicts = predicts_;
+    std::vector<Call*> old_aggs = aggs_;
+
     AttributeSet* input_attrs;
     {
         Status s = Verify(scan->input_, &input_attrs);
@@ -601,6 +701,8 @@ Status Analyzer::Verify(ProjectScan* scan, AttributeSet** working_attrs) {
             return s;
     }
 
+    scan->input_ = ChooseJoin(scan->input_);
+
     scopes_.push_back(input_attrs);
     scan->input_attrs_ = input_attrs;
 
@@ -628,18 +730,21 @@ Status Analyzer::Verify(ProjectScan* scan, AttributeSet** working_attrs) {
 
 
     //add ghost order columns to projection columns if not already included
-    //need this to be able to sort by a column even if that column will not end up in the output
-    std::unordered_map<std::string, bool> included;
-    for (Expr* e: scan->projs_) {
-        included.insert({e->ToString(), true});
+    //need this to be able to sort by a column even if that column will not end up in the output.
+    //rows are sorted by the projected values, so order expressions are never evaluated while sorting
+    std::unordered_map<std::string, int> included;
+    for (size_t i = 0; i < scan->projs_.size(); i++) {
+        included.insert({scan->projs_.at(i)->ToString(), i});
     }
     scan->ghost_column_count_ = 0;
-    for (OrderCol oc: scan->order_cols_) {
-        if (included.find(oc.col->ToString()) == included.end()) {
-            included.insert({oc.col->ToString(), true});
+    for (OrderCol& oc: scan->order_cols_) {
+        std::unordered_map<std::string, int>::iterator it = included.find(oc.col->ToString());
+        if (it == included.end()) {
+            it = included.insert({oc.col->ToString(), scan->projs_.size()}).first;
             scan->projs_.push_back(oc.col);
             scan->ghost_column_count_++;
         }
+        oc.idx = it->second;
     }
 
     //add ghost column for 'having' clause
@@ -654,11 +759,14 @@ Status Analyzer::Verify(ProjectScan* scan, AttributeSet** working_attrs) {
         if (!s.Ok()) {
             return s;
         }
+        Compile(e);
     }
 
     //projection
     {
         bool old_has_agg = has_agg_;
+        predicts_.clear();
+        aggs_.clear();
         std::vector<Attribute> attrs;
         std::vector<bool> dummy_not_nulls;
         for (Expr* e: scan->projs_) {
@@ -668,6 +776,7 @@ Status Analyzer::Verify(ProjectScan* scan, AttributeSet** working_attrs) {
                 return s;
             }
 
+            Compile(e);
             attrs.push_back(attr);
             dummy_not_nulls.push_back(false);
             if (has_agg_) {
@@ -675,6 +784,8 @@ Status Analyzer::Verify(ProjectScan* scan, AttributeSet** working_attrs) {
             }
         }
         has_agg_ = old_has_agg;
+        scan->predicts_ = predicts_;
+        scan->aggs_ = aggs_;
 
         *working_attrs = new AttributeSet(attrs, dummy_not_nulls);
         scan->output_attrs_ = *working_attrs;
@@ -683,24 +794,6 @@ Status Analyzer::Verify(ProjectScan* scan, AttributeSet** working_attrs) {
     scopes_.pop_back();
     scopes_.push_back(scan->output_attrs_);
 
-    //order cols
-    for (OrderCol oc: scan->order_cols_) {
-        {
-            Attribute attr;
-            Status s = Verify(oc.col, &attr);
-            if (!s.Ok())
-                return s;
-        }
-
-        {
-            Attribute attr;
-            Status s = Verify(oc.asc, &attr);
-            if (!s.Ok()) {
-                return s;
-            }
-        }
-    }
-
     //limit
     {
         Attribute attr;
@@ -715,8 +808,244 @@ Status Analyzer::Verify(ProjectScan* scan, AttributeSet** working_attrs) {
     }
 
     scopes_.pop_back();
+    predicts_ = old_predicts;
+    aggs_ = old_aggs;
 
     return Status(); 
 }
 
+/*
+ * Projection pushdown
+ */
+
+//Rows from a table scan are visible through its own attribute set and the sets of any products above
+//it, so a column bound in any of those is traced back to the scan that reads it
+void Analyzer::MarkColumnUsed(AttributeSet* as, int idx) {
+    std::unordered_map<AttributeSet*, std::vector<std::pair<TableScan*, int>>>::iterator it = table_cols_.find(as);
+    if (it == table_cols_.end())
+        return;
+
+    for (const std::pair<TableScan*, int>& p: it->second) {
+        int col = idx - p.second;
+        if (col >= 0 && (size_t)col < p.first->used_cols_.size())
+            p.first->used_cols_.at(col) = true;
+    }
+}
+
+void Analyzer::MarkAllColumnsUsed(AttributeSet* as) {
+    for (size_t i = 0; i < as->AttributeCount(); i++) {
+        MarkColumnUsed(as, i);
+    }
+}
+
+/*
+ * Access path selection
+ */
+
+//Picks the index with the most leading key columns constrained by equality predicates in the where clause,
+//plus an optional range on the key column after those.  The where clause is still evaluated by the SelectScan 
+//on every returned row, so the index scan only needs to return a superset of the matching rows
+void Analyzer::ChooseIndex(TableScan* scan, Expr* where_clause) {
+    std::vector<Expr*> conjuncts;
+    GetConjuncts(where_clause, conjuncts);
+
+    //column index in table -> expression that column is compared to
+    std::unordered_map<int, Expr*> equalities;
+    std::unordered_map<int, Expr*> lowers;
+    std::unordered_map<int, Expr*> uppers;
+    for (Expr* e: conjuncts) {
+        if (e->Type() != ExprType::Binary)
+            continue;
+
+        Binary* b = (Binary*)e;
+        ColRef* col = nullptr;
+        Expr* value = nullptr;
+        bool col_on_left = true;
+        if (b->left_->Type() == ExprType::ColRef && ((ColRef*)b->left_)->col_.table == scan->ref_name_) {
+            col = (ColRef*)b->left_;
+            value = b->right_;
+        } else if (b->right_->Type() == ExprType::ColRef && ((ColRef*)b->right_)->col_.table == scan->ref_name_) {
+            col = (ColRef*)b->right_;
+            value = b->left_;
+            col_on_left = false;
+        }
+
+        if (!col || !IsIndependentOf(value, scan->ref_name_))
+            continue;
+
+        int attr_idx = scan->table_->GetAttrIdx(col->col_.name);
+        if (attr_idx == -1)
+            continue;
+
+        switch (b->op_.type) {
+            case TokenType::Equal:
+                equalities.insert({ attr_idx, value });
+                break;
+            case TokenType::Greater:
+            case TokenType::GreaterEqual:
+                (col_on_left ? lowers : uppers).insert({ attr_idx, value });
+                break;
+            case TokenType::Less:
+            case TokenType::LessEqual:
+                (col_on_left ? uppers : lowers).insert({ attr_idx, value });
+                break;
+            default:
+                break;
+        }
+    }
+
+    //each equality column is worth more than a range on the following column
+    size_t best_score = 0;
+    size_t best_count = 0;
+    for (size_t i = 0; i < scan->table_->idxs_.size(); i++) {
+        const Index& idx = scan->table_->idxs_.at(i);
+        size_t count = 0;
+        while (count < idx.key_idxs_.size() && equalities.find(idx.key_idxs_.at(count)) != equalities.end()) {
+            count++;
+        }
+
+        size_t score = count * 2;
+        if (count < idx.key_idxs_.size()) {
+            int next_col = idx.key_idxs_.at(count);
+            if (lowers.find(next_col) != lowers.end() || uppers.find(next_col) != uppers.end())
+                score++;
+        }
+
+        if (score > best_score) {
+            best_score = score;
+            best_count = count;
+            scan->scan_idx_ = i;
+        }
+    }
+
+    scan->key_exprs_.clear();
+    scan->lower_expr_ = nullptr;
+    scan->upper_expr_ = nullptr;
+
+    const Index& idx = scan->table_->idxs_.at(scan->scan_idx_);
+    for (size_t i = 0; i < best_count; i++) {
+        scan->key_exprs_.push_back(equalities.at(idx.key_idxs_.at(i)));
+    }
+
+    if (best_score % 2 == 1) {
+        int range_col = idx.key_idxs_.at(best_count);
+        if (lowers.find(range_col) != lowers.end())
+            scan->lower_expr_ = lowers.at(range_col);
+        if (uppers.find(range_col) != uppers.end())
+            scan->upper_expr_ = uppers.at(range_col);
+    }
+}
+
+//Returns a HashJoinScan in place of a join if the join predicate contains at least one
+//equality between a column of the left input and a column of the right input
+//Joins nested in either input are chosen first, so every join of a 3+ way join is considered
+//Any other scan is returned unchanged
+Scan* Analyzer::ChooseJoin(Scan* scan) {
+    ProductScan* product;
+    Expr* expr;
+    bool include_left = false;
+    bool include_right = false;
+    if (scan->Type() == ScanType::Product) {
+        product = (ProductScan*)scan;
+        product->left_ = ChooseJoin(product->left_);
+        product->right_ = ChooseJoin(product->right_);
+        return scan;
+    } else if (scan->Type() == ScanType::Select && ((SelectScan*)scan)->scan_->Type() == ScanType::Product) {
+        product = (ProductScan*)((SelectScan*)scan)->scan_;
+        expr = ((SelectScan*)scan)->expr_;
+    } else if (scan->Type() == ScanType::OuterSelect) {
+        OuterSelectScan* outer = (OuterSelectScan*)scan;
+        product = outer->scan_;
+        expr = outer->expr_;
+        include_left = outer->include_left_;
+        include_right = outer->include_right_;
+    } else {
+        return scan;
+    }
+
+    product->left_ = ChooseJoin(product->left_);
+    product->right_ = ChooseJoin(product->right_);
+
+    std::vector<Expr*> conjuncts;
+    GetConjuncts(expr, conjuncts);
+
+    std::vector<Expr*> left_keys;
+    std::vector<Expr*> right_keys;
+    std::vector<int> left_key_idxs;
+    std::vector<int> right_key_idxs;
+    for (Expr* e: conjuncts) {
+        if (e->Type() != ExprType::Binary || ((Binary*)e)->op_.type != TokenType::Equal)
+            continue;
+
+        Binary* b = (Binary*)e;
+        if (b->left_->Type() != ExprType::ColRef || b->right_->Type() != ExprType::ColRef)
+            continue;
+
+        ColRef* first = (ColRef*)b->left_;
+        ColRef* second = (ColRef*)b->right_;
+        Attribute first_attr;
+        Attribute second_attr;
+        int first_idx;
+        int second_idx;
+        if (product->left_->output_attrs_->GetAttribute(&first->col_, &first_attr, &first_idx).Ok() &&
+            product->right_->output_attrs_->GetAttribute(&second->col_, &second_attr, &second_idx).Ok()) {
+            //first is from left input, second is from right input
+        } else if (product->left_->output_attrs_->GetAttribute(&second->col_, &second_attr, &second_idx).Ok() &&
+                   product->right_->output_attrs_->GetAttribute(&first->col_, &first_attr, &first_idx).Ok()) {
+            std::swap(first, second);
+            std::swap(first_idx, second_idx);
+        } else {
+            continue;
+        }
+
+        //hash keys are compared as bytes, so both sides must have the same type
+        if (first_attr.type != second_attr.type)
+            continue;
+
+        left_keys.push_back(first);
+        right_keys.push_back(second);
+        left_key_idxs.push_back(first_idx);
+        right_key_idxs.push_back(second_idx);
+    }
+
+    if (left_keys.empty())
+        return scan;
+
+    HashJoinScan* hash_join = new HashJoinScan(product->left_, product->right_, expr, include_left, include_right, left_keys, right_keys);
+    hash_join->output_attrs_ = product->output_attrs_;
+    hash_join->left_key_idxs_ = left_key_idxs;
+    hash_join->right_key_idxs_ = right_key_idxs;
+
+    return hash_join;
+}
+
+void Analyzer::GetConjuncts(Expr* expr, std::vector<Expr*>& conjuncts) {
+    if (expr->Type() == ExprType::Binary && ((Binary*)expr)->op_.type == TokenType::And) {
+        GetConjuncts(((Binary*)expr)->left_, conjuncts);
+        GetConjuncts(((Binary*)expr)->right_, conjuncts);
+        return;
+    }
+
+    conjuncts.push_back(expr);
+}
+
+//true if expression can be evaluated once before scanning the table with the given reference name
+//(literals and columns from outer queries only)
+bool Analyzer::IsIndependentOf(Expr* expr, const std::string& ref_name) {
+    switch (expr->Type()) {
+        case ExprType::Literal:
+            return ((Literal*)expr)->t_.type != TokenType::Star;
+        case ExprType::ColRef:
+            return ((ColRef*)expr)->col_.table != ref_name;
+        case ExprType::Unary:
+            return IsIndependentOf(((Unary*)expr)->right_, ref_name);
+        case ExprType::Binary:
+            return IsIndependentOf(((Binary*)expr)->left_, ref_name) && IsIndependentOf(((Binary*)expr)->right_, ref_name);
+        case ExprType::Cast:
+            return IsIndependentOf(((Cast*)expr)->value_, ref_name);
+        default:
+            return false;
+    }
+}
+
 }
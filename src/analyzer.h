@@ -4,6 +4,7 @@
 #include "status.h"
 #include "stmt.h"
 #include "expr.h"
+#include "program.h"
 #include "storage.h"
 #include "txn.h"
 
@@ -11,10 +12,11 @@ namespace wsldb {
 
 class Analyzer {
 public:
-    Analyzer(Txn** txn): txn_(txn) {}
+    Analyzer(Txn** txn, Storage* storage): txn_(txn), storage_(storage) {}
     Status Verify(Stmt* stmt, AttributeSet** working_attrs);
 private:
     //statements
+    Status VerifyStmt(Stmt* stmt, AttributeSet** working_attrs);
     Status CreateVerifier(CreateStmt* stmt);
     Status InsertVerifier(InsertStmt* stmt);
     Status UpdateVerifier(UpdateStmt* stmt);
@@ -25,6 +27,9 @@ private:
     Status TxnControlVerifier(TxnControlStmt* stmt);
     Status CreateModelVerifier(CreateModelStmt* stmt);
     Status DropModelVerifier(DropModelStmt* stmt);
+    Status CopyFromVerifier(CopyFromStmt* stmt);
+    Status CopyToVerifier(CopyToStmt* stmt);
+    Status SetVerifier(SetStmt* stmt);
 
     //expressions
     Status Verify(Expr* expr, Attribute* attr);
@@ -39,6 +44,7 @@ private:
     Status VerifyScalarSubquery(ScalarSubquery* expr, Attribute* attr);
     Status VerifyPredict(Predict* expr, Attribute* attr);
     Status VerifyCast(Cast* expr, Attribute* attr);
+    void Compile(Expr* expr);
 
     Status Verify(Scan* scan, AttributeSet** working_attrs);
 
@@ -49,24 +55,36 @@ private:
     Status Verify(OuterSelectScan* scan, AttributeSet** working_attrs);
     Status Verify(ProjectScan* scan, AttributeSet** working_attrs);
 
-    Status GetSchema(const std::string& table_name, Table** schema) {
-        *schema = nullptr;
+    //access path selection
+    void ChooseIndex(TableScan* scan, Expr* where_clause);
+    Scan* ChooseJoin(Scan* scan);
+    void GetConjuncts(Expr* expr, std::vector<Expr*>& conjuncts);
+    bool IsIndependentOf(Expr* expr, const std::string& ref_name);
 
-        std::string serialized_schema;
-        bool ok = (*txn_)->Get(Storage::Catalog(), table_name, &serialized_schema).Ok();
+    //projection pushdown
+    void MarkColumnUsed(AttributeSet* as, int idx);
+    void MarkAllColumnsUsed(AttributeSet* as);
+
+    Status GetSchema(const std::string& table_name, std::shared_ptr<const Table>* schema) {
+        schema->reset();
+
+        bool ok = storage_->GetTable(table_name, *txn_, schema).Ok();
 
         if (!ok)
             return Status(false, "Analysis Error: Table with name '" + table_name + "' doesn't exist");
 
-        *schema = new Table(table_name, serialized_schema);
-
         return Status();
     }
 
 private:
     Txn** txn_;
+    Storage* storage_;
     std::vector<AttributeSet*> scopes_;
     bool has_agg_ {false};
+    std::vector<Predict*> predicts_;
+    std::vector<Call*> aggs_;
+    //table scans whose columns appear in an attribute set, and the index in the set of each scan's first column
+    std::unordered_map<AttributeSet*, std::vector<std::pair<TableScan*, int>>> table_cols_;
 };
 
 }
@@ -0,0 +1,434 @@
+#include <thread>
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <ctime>
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "copy.h"
+
+namespace wsldb {
+
+static Status CopyError(size_t row_num, const std::string& msg) {
+    return Status(false, "Execution Error: Row " + std::to_string(row_num) + " of copy file " + msg);
+}
+
+static bool IsHexDigit(char c) {
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+}
+
+//non-null csv fields are parsed using the same lexemes as sql literals
+static bool ParseCsvField(const std::string& field, DatumType type, Datum* result) {
+    switch (type) {
+        case DatumType::Int8: {
+            if (field.empty())
+                return false;
+            errno = 0;
+            char* end;
+            long long value = strtoll(field.c_str(), &end, 10);
+            if (errno != 0 || *end != '\0')
+                return false;
+            *result = Datum(static_cast<int64_t>(value));
+            return true;
+        }
+        case DatumType::Float4: {
+            if (field.empty())
+                return false;
+            errno = 0;
+            char* end;
+            float value = strtof(field.c_str(), &end);
+            if (errno != 0 || *end != '\0')
+                return false;
+            *result = Datum(value);
+            return true;
+        }
+        case DatumType::Bool: {
+            if (field.compare("true") == 0 || field.compare("t") == 0) {
+                *result = Datum(true);
+                return true;
+            }
+            if (field.compare("false") == 0 || field.compare("f") == 0) {
+                *result = Datum(false);
+                return true;
+            }
+            return false;
+        }
+        case DatumType::Text: {
+            *result = Datum(field);
+            return true;
+        }
+        case DatumType::Bytea: {
+            if (field.size() < 2 || field.at(0) != '\\' || field.at(1) != 'x' || field.size() % 2 != 0)
+                return false;
+            for (size_t i = 2; i < field.size(); i++) {
+                if (!IsHexDigit(field.at(i)))
+                    return false;
+            }
+            *result = Datum(DatumType::Bytea, field);
+            return true;
+        }
+        case DatumType::Timestamp: {
+            struct tm tm;
+            if (!strptime(field.c_str(), "%Y-%m-%d %H:%M:%S", &tm))
+                return false;
+            *result = Datum(DatumType::Timestamp, field);
+            return true;
+        }
+        default:
+            return false;
+    }
+}
+
+static Status ParseCsvRecord(std::string_view buf, const CopyRecord& record, size_t row_num,
+                             const std::vector<DatumType>& types, std::vector<Datum>* data) {
+    size_t idx = record.off;
+    size_t end = record.off + record.len;
+
+    while (true) {
+        if (data->size() == types.size())
+            return CopyError(row_num, "has more than " + std::to_string(types.size()) + " fields");
+
+        std::string field;
+        bool quoted = idx < end && buf.at(idx) == '"';
+        if (quoted) {
+            idx++;
+            while (true) {
+                if (idx >= end)
+                    return CopyError(row_num, "has an unterminated quoted field");
+                if (buf.at(idx) == '"') {
+                    if (idx + 1 < end && buf.at(idx + 1) == '"') {
+                        field += '"';
+                        idx += 2;
+                        continue;
+                    }
+                    idx++;
+                    break;
+                }
+                field += buf.at(idx);
+                idx++;
+            }
+            if (idx < end && buf.at(idx) != ',')
+                return CopyError(row_num, "has characters after a closing quote");
+        } else {
+            size_t start = idx;
+            while (idx < end && buf.at(idx) != ',') {
+                idx++;
+            }
+            field = std::string(buf.substr(start, idx - start));
+        }
+
+        DatumType type = types.at(data->size());
+        if (!quoted && field.empty()) {
+            data->push_back(Datum());
+        } else {
+            Datum d;
+            if (!ParseCsvField(field, type, &d))
+                return CopyError(row_num, "has invalid " + Datum::TypeToString(type) + " value '" + field + "'");
+            data->push_back(d);
+        }
+
+        if (idx >= end)
+            break;
+        idx++; //skip comma
+    }
+
+    if (data->size() != types.size())
+        return CopyError(row_num, "has fewer than " + std::to_string(types.size()) + " fields");
+
+    return Status();
+}
+
+static Status ParseBinaryRecord(std::string_view buf, const CopyRecord& record, size_t row_num,
+                                const std::vector<DatumType>& types, std::vector<Datum>* data) {
+    //Datum deserialization doesn't check bounds, so check each field before reading it.  Offsets are
+    //relative to the record (whose size is an int), so they can't overflow in files over 2GB
+    std::string_view rec = buf.substr(record.off, record.len);
+    int off = 0;
+    size_t end = rec.size();
+    for (DatumType type: types) {
+        if (off + sizeof(bool) > end)
+            return CopyError(row_num, "is truncated");
+
+        bool is_null = *((bool*)(rec.data() + off));
+        if (!is_null) {
+            size_t size = 0;
+            switch (type) {
+                case DatumType::Int8:       size = sizeof(int64_t); break;
+                case DatumType::Float4:     size = sizeof(float); break;
+                case DatumType::Bool:       size = sizeof(bool); break;
+                case DatumType::Timestamp:  size = sizeof(time_t); break;
+                case DatumType::Text:
+                case DatumType::Bytea: {
+                    if (off + sizeof(bool) + sizeof(int) > end)
+                        return CopyError(row_num, "is truncated");
+                    int text_size = *((int*)(rec.data() + off + sizeof(bool)));
+                    if (text_size < 0)
+                        return CopyError(row_num, "has a negative field size");
+                    size = sizeof(int) + text_size;
+                    break;
+                }
+                default:
+                    return CopyError(row_num, "has an invalid field type");
+            }
+            if (off + sizeof(bool) + size > end)
+                return CopyError(row_num, "is truncated");
+        }
+
+        data->push_back(Datum(rec, &off, type));
+    }
+
+    if ((size_t)off != end)
+        return CopyError(row_num, "has more than " + std::to_string(types.size()) + " fields");
+
+    return Status();
+}
+
+Status SplitCopyRecords(std::string_view buf, CopyFormat format, std::vector<CopyRecord>* records) {
+    size_t idx = 0;
+    switch (format) {
+        case CopyFormat::Csv: {
+            //newlines inside quoted fields are part of the field, not the end of the row
+            bool in_quotes = false;
+            size_t start = 0;
+            for (; idx <= buf.size(); idx++) {
+                if (idx < buf.size() && buf.at(idx) == '"') {
+                    in_quotes = !in_quotes;
+                    continue;
+                }
+                if (idx < buf.size() && (buf.at(idx) != '\n' || in_quotes))
+                    continue;
+
+                size_t len = idx - start;
+                if (len > 0 && buf.at(start + len - 1) == '\r')
+                    len--;
+                if (len > 0) //skip blank lines
+                    records->push_back({start, len});
+                start = idx + 1;
+            }
+            return Status();
+        }
+        case CopyFormat::Binary: {
+            while (idx < buf.size()) {
+                if (idx + sizeof(int) > buf.size())
+                    return CopyError(records->size() + 1, "is truncated");
+                int size = *((int*)(buf.data() + idx));
+                idx += sizeof(int);
+                if (size < 0 || idx + size > buf.size())
+                    return CopyError(records->size() + 1, "is truncated");
+                records->push_back({idx, (size_t)size});
+                idx += size;
+            }
+            return Status();
+        }
+        default:
+            return Status(false, "Execution Error: Invalid copy format");
+    }
+}
+
+Status ParseCopyRecord(std::string_view buf, const CopyRecord& record, size_t row_num, CopyFormat format,
+                       const std::vector<DatumType>& types, std::vector<Datum>* data) {
+    switch (format) {
+        case CopyFormat::Csv:
+            return ParseCsvRecord(buf, record, row_num, types, data);
+        case CopyFormat::Binary:
+            return ParseBinaryRecord(buf, record, row_num, types, data);
+        default:
+            return Status(false, "Execution Error: Invalid copy format");
+    }
+}
+
+Status ParseCopyRecords(std::string_view buf, const std::vector<CopyRecord>& records, CopyFormat format,
+                        const std::vector<DatumType>& types, std::vector<std::vector<Datum>>* rows) {
+    rows->clear();
+    rows->resize(records.size());
+
+    size_t thread_count = std::max(1u, std::thread::hardware_concurrency());
+    thread_count = std::min(thread_count, records.size() / COPY_MIN_ROWS_PER_THREAD + 1);
+    size_t rows_per_thread = (records.size() + thread_count - 1) / thread_count;
+
+    //each thread parses a contiguous range of records, and reports the first error in its range
+    std::vector<Status> statuses(thread_count);
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < thread_count; t++) {
+        threads.emplace_back([&, t]() {
+            size_t end = std::min(records.size(), (t + 1) * rows_per_thread);
+            for (size_t i = t * rows_per_thread; i < end; i++) {
+                Status s = ParseCopyRecord(buf, records.at(i), i + 1, format, types, &rows->at(i));
+                if (!s.Ok()) {
+                    statuses.at(t) = s;
+                    return;
+                }
+            }
+        });
+    }
+
+    for (std::thread& thread: threads) {
+        thread.join();
+    }
+
+    for (Status& s: statuses) {
+        if (!s.Ok())
+            return s;
+    }
+
+    return Status();
+}
+
+CopyFileMap::~CopyFileMap() {
+    if (data_)
+        munmap(data_, size_);
+}
+
+Status CopyFileMap::Open() {
+    int fd = open(path_.c_str(), O_RDONLY);
+    if (fd < 0)
+        return Status(false, "Execution Error: Could not read file '" + path_ + "'");
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        close(fd);
+        return Status(false, "Execution Error: Could not read file '" + path_ + "'");
+    }
+
+    //an empty file can't be mapped, but is just a copy of zero rows
+    if (st.st_size > 0) {
+        void* data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            close(fd);
+            return Status(false, "Execution Error: Could not read file '" + path_ + "'");
+        }
+        data_ = (char*)data;
+        size_ = st.st_size;
+    }
+
+    //the mapping stays valid after the descriptor is closed
+    close(fd);
+    return Status();
+}
+
+Status CopyFileSink::Open() {
+    out_.open(path_, std::ios::binary | std::ios::trunc);
+    if (!out_)
+        return Status(false, "Execution Error: Could not open file '" + path_ + "' for writing");
+    buf_.reserve(COPY_WRITE_BUFFER_SIZE);
+    return Status();
+}
+
+Status CopyFileSink::Close() {
+    bool ok = Flush();
+    out_.close();
+    if (!ok || out_.fail())
+        return Status(false, "Execution Error: Could not write to file '" + path_ + "'");
+    return Status();
+}
+
+bool CopyFileSink::PushRow(const Row& row) {
+    switch (format_) {
+        case CopyFormat::Csv: {
+            for (size_t i = 0; i < row.data_.size(); i++) {
+                if (i > 0)
+                    buf_ += ',';
+                AppendCsvField(row.data_.at(i));
+            }
+            buf_ += '\n';
+            break;
+        }
+        case CopyFormat::Binary: {
+            //size is written once the row is serialized in place
+            size_t size_off = buf_.size();
+            int size = 0;
+            buf_.append((char*)&size, sizeof(int));
+            for (const Datum& d: row.data_) {
+                d.SerializeTo(&buf_);
+            }
+            size = buf_.size() - size_off - sizeof(int);
+            memcpy(&buf_[size_off], &size, sizeof(int));
+            break;
+        }
+        default:
+            return false;
+    }
+
+    row_count_++;
+
+    if (buf_.size() >= COPY_WRITE_BUFFER_SIZE)
+        return Flush();
+
+    return true;
+}
+
+//the inverse of ParseCsvField - null is an empty field, so empty text is quoted
+void CopyFileSink::AppendCsvField(const Datum& d) {
+    switch (d.Type()) {
+        case DatumType::Null:
+            break;
+        case DatumType::Int8:
+            buf_ += std::to_string(d.AsInt8());
+            break;
+        case DatumType::Float4: {
+            //shortest representation that parses back to the same float
+            float f = d.AsFloat4();
+            char s[32];
+            int len = 0;
+            for (int precision = 6; precision <= 9; precision++) {
+                len = snprintf(s, sizeof(s), "%.*g", precision, f);
+                if (strtof(s, nullptr) == f)
+                    break;
+            }
+            buf_.append(s, len);
+            break;
+        }
+        case DatumType::Bool:
+            buf_ += d.AsBool() ? "true" : "false";
+            break;
+        case DatumType::Text: {
+            std::string_view text = d.TextView();
+            if (!text.empty() && text.find_first_of(",\"\r\n") == std::string_view::npos) {
+                buf_ += text;
+                break;
+            }
+            buf_ += '"';
+            for (char c: text) {
+                if (c == '"')
+                    buf_ += '"';
+                buf_ += c;
+            }
+            buf_ += '"';
+            break;
+        }
+        case DatumType::Bytea: {
+            static const char* hex = "0123456789abcdef";
+            buf_ += "\\x";
+            for (char c: d.TextView()) {
+                buf_ += hex[(unsigned char)c >> 4];
+                buf_ += hex[(unsigned char)c & 0xf];
+            }
+            break;
+        }
+        case DatumType::Timestamp: {
+            time_t t = d.AsTimestamp();
+            struct tm tm;
+            localtime_r(&t, &tm);
+            char s[32];
+            size_t len = strftime(s, sizeof(s), "%Y-%m-%d %H:%M:%S", &tm);
+            buf_.append(s, len);
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+bool CopyFileSink::Flush() {
+    if (!buf_.empty()) {
+        out_.write(buf_.data(), buf_.size());
+        buf_.clear();
+    }
+    return !out_.fail();
+}
+
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <fstream>
+
+#include "datum.h"
+#include "status.h"
+#include "row_sink.h"
+
+//rows parsed by a single thread during COPY FROM - fewer rows than this are not worth a thread
+#define COPY_MIN_ROWS_PER_THREAD 4096
+//COPY TO buffers output and writes it to the file in chunks of about this size
+#define COPY_WRITE_BUFFER_SIZE (1 << 20)
+
+namespace wsldb {
+
+//CSV files have one row per line with comma separated fields.  Empty unquoted fields are null,
+//and fields containing commas, quotes or newlines are double quoted (with "" as an escaped quote).
+//Binary files are a sequence of records - each record is the int size of the row followed by the
+//row serialized with Datum::SerializeData (a null flag, and then the value, for each field)
+enum class CopyFormat {
+    Csv,
+    Binary
+};
+
+//a record is the offset and length of a single row within a COPY file
+struct CopyRecord {
+    size_t off;
+    size_t len;
+};
+
+Status SplitCopyRecords(std::string_view buf, CopyFormat format, std::vector<CopyRecord>* records);
+Status ParseCopyRecord(std::string_view buf, const CopyRecord& record, size_t row_num, CopyFormat format,
+                       const std::vector<DatumType>& types, std::vector<Datum>* data);
+//parses all records, splitting the work across threads - rows->at(i) is the data for records.at(i)
+Status ParseCopyRecords(std::string_view buf, const std::vector<CopyRecord>& records, CopyFormat format,
+                        const std::vector<DatumType>& types, std::vector<std::vector<Datum>>* rows);
+
+//Maps a COPY FROM file into memory, so records are split and parsed in place rather than the
+//whole file first being copied into a string.  The mapping is released when this is destroyed
+class CopyFileMap {
+public:
+    CopyFileMap(const std::string& path): path_(path) {}
+    ~CopyFileMap();
+    Status Open();
+    inline std::string_view Data() const { return std::string_view(data_, size_); }
+private:
+    std::string path_;
+    char* data_ {nullptr};
+    size_t size_ {0};
+};
+
+//Writes the rows of a COPY TO query to a file in the same formats read by COPY FROM.
+//Rows are encoded as they are produced by the scan, so the query result is never materialized
+class CopyFileSink: public RowSink {
+public:
+    CopyFileSink(const std::string& path, CopyFormat format): path_(path), format_(format) {}
+    Status Open();
+    //flushes any buffered rows - must be called after the last row
+    Status Close();
+    void BeginRows(const std::vector<Attribute>&) override {}
+    bool PushRow(const Row& row) override;
+    void EndStmt(Status) override {}
+    inline size_t RowCount() const { return row_count_; }
+private:
+    void AppendCsvField(const Datum& d);
+    bool Flush();
+private:
+    std::string path_;
+    CopyFormat format_;
+    std::ofstream out_;
+    std::string buf_;
+    size_t row_count_ {0};
+};
+
+}
@@ -1,25 +1,35 @@
 #include <fstream>
 #include <sstream>
+#include <thread>
+#include <algorithm>
+#include <cstring>
 #include <iostream> //TODO: remove this later
 
 #include "executor.h"
 #include "table.h"
+#include "index.h"
 #include "tokenizer.h"
 #include "parser.h"
 #include "analyzer.h"
 #include "matcher.h"
+#include "row_format.h"
 
 namespace wsldb {
 
-std::vector<Status> Executor::ExecuteQuery(const std::string& query) {
+//If sink is provided, rows of top level selects are pushed to it as they are produced and
+//each statement's status is passed to it when the statement ends
+std::vector<Status> Executor::ExecuteQuery(const std::string& query, RowSink* sink) {
     std::vector<Token> tokens = std::vector<Token>();
     {
         Tokenizer tokenizer(query);
         do {
             Token t;
             Status s = tokenizer.NextToken(&t);
-            if (!s.Ok())
+            if (!s.Ok()) {
+                if (sink)
+                    sink->EndStmt(s);
                 return {s};
+            }
 
             tokens.push_back(t);
         } while (tokens.back().type != TokenType::Eof);
@@ -29,13 +39,16 @@ std::vector<Status> Executor::ExecuteQuery(const std::string& query) {
     {
         Parser parser(tokens);
         Status s = parser.ParseStmts(stmts);
-        if (!s.Ok())
+        if (!s.Ok()) {
+            if (sink)
+                sink->EndStmt(s);
             return {s};
+        }
     }
 
     std::vector<Status> statuses;
     {
-        Analyzer a(txn_);
+        Analyzer a(txn_, storage_);
         for (Stmt* stmt: stmts) {
 
             //creating a transaction if not explicitly created
@@ -47,7 +60,7 @@ std::vector<Status> Executor::ExecuteQuery(const std::string& query) {
             AttributeSet* working_attrs;
             Status s = a.Verify(stmt, &working_attrs);
             if (s.Ok())
-                s = Execute(stmt);
+                s = Execute(stmt, sink);
 
             //ending automatically created txn
             if (auto_commit) {
@@ -61,6 +74,9 @@ std::vector<Status> Executor::ExecuteQuery(const std::string& query) {
                 *txn_ = nullptr;
             }
 
+            if (sink)
+                sink->EndStmt(s);
+
             statuses.push_back(s);
         }
 
@@ -69,7 +85,7 @@ std::vector<Status> Executor::ExecuteQuery(const std::string& query) {
     return statuses;
 }
 
-Status Executor::Execute(Stmt* stmt) {
+Status Executor::Execute(Stmt* stmt, RowSink* sink) {
 
     if (*txn_ && (*txn_)->has_aborted_ && stmt->Type() != StmtType::TxnControl) {
         return Status(false, "Execution Error: Transaction has aborted and will ignore all statements until ended");
@@ -91,7 +107,7 @@ Status Executor::Execute(Stmt* stmt) {
             s = DeleteExecutor((DeleteStmt*)stmt);
             break;
         case StmtType::Select:
-            s = SelectExecutor((SelectStmt*)stmt);
+            s = SelectExecutor((SelectStmt*)stmt, sink);
             break;
         case StmtType::DescribeTable:
             s = DescribeTableExecutor((DescribeTableStmt*)stmt);
@@ -108,6 +124,15 @@ Status Executor::Execute(Stmt* stmt) {
         case StmtType::DropModel:
             s = DropModelExecutor((DropModelStmt*)stmt);
             break;
+        case StmtType::CopyFrom:
+            s = CopyFromExecutor((CopyFromStmt*)stmt);
+            break;
+        case StmtType::CopyTo:
+            s = CopyToExecutor((CopyToStmt*)stmt);
+            break;
+        case StmtType::Set:
+            s = SetExecutor((SetStmt*)stmt);
+            break;
         default:
             s = Status(false, "Execution Error: Invalid statement type");
             break;
@@ -120,6 +145,182 @@ Status Executor::Execute(Stmt* stmt) {
 }
 
 Status Executor::Eval(Expr* expr, Datum* result) {
+    if (expr->program_)
+        return Run(expr->program_, result);
+
+    return EvalTree(expr, result);
+}
+
+//Runs a compiled expression.  Typed instructions only check operand types and compute the result
+//in place, and a Status is only constructed for errors and uncompiled subexpressions
+Status Executor::Run(Program* program, Datum* result) {
+    std::vector<Datum>& regs = program->regs_;
+    for (const Instr& in: program->code_) {
+        Datum& dst = regs[in.dst];
+        switch (in.op) {
+            case OpCode::ColRef: {
+                ColRef* col = (ColRef*)program->exprs_[in.a];
+                if (col->depth_ >= 0 && (size_t)col->depth_ < attrs_.size() && attrs_.rbegin()[col->depth_] == col->scope_) {
+                    dst = scopes_.rbegin()[col->depth_]->data_[col->idx_];
+                    break;
+                }
+
+                Status s = Eval(col, &dst);
+                if (!s.Ok()) return s;
+                break;
+            }
+            case OpCode::Eval: {
+                Status s = EvalTree(program->exprs_[in.a], &dst);
+                if (!s.Ok()) return s;
+                break;
+            }
+            case OpCode::IntBinary: {
+                Datum& l = regs[in.a];
+                Datum& r = regs[in.b];
+                if (!l.IsType(DatumType::Int8) || !r.IsType(DatumType::Int8)) {
+                    if (!EvalBinaryOp(in.fn, l, r, &dst))
+                        return BinaryOpError(in.fn);
+                    break;
+                }
+
+                int64_t x = l.AsInt8();
+                int64_t y = r.AsInt8();
+                switch (in.fn) {
+                    case TokenType::Equal:          dst = Datum(x == y); break;
+                    case TokenType::NotEqual:       dst = Datum(x != y); break;
+                    case TokenType::Less:           dst = Datum(x < y); break;
+                    case TokenType::LessEqual:      dst = Datum(x <= y); break;
+                    case TokenType::Greater:        dst = Datum(x > y); break;
+                    case TokenType::GreaterEqual:   dst = Datum(x >= y); break;
+                    case TokenType::Plus:           dst = Datum(static_cast<int64_t>(x + y)); break;
+                    case TokenType::Minus:          dst = Datum(static_cast<int64_t>(x - y)); break;
+                    case TokenType::Star:           dst = Datum(static_cast<int64_t>(x * y)); break;
+                    case TokenType::Slash:
+                        if (y == 0)
+                            return BinaryOpError(in.fn);
+                        dst = Datum(static_cast<int64_t>(x / y));
+                        break;
+                    default:
+                        return BinaryOpError(in.fn);
+                }
+                break;
+            }
+            case OpCode::FloatBinary: {
+                Datum& l = regs[in.a];
+                Datum& r = regs[in.b];
+                if (l.IsType(DatumType::Null) || r.IsType(DatumType::Null)) {
+                    dst = Datum();
+                    break;
+                }
+                if (!Datum::TypeIsNumeric(l.Type()) || !Datum::TypeIsNumeric(r.Type())) {
+                    if (!EvalBinaryOp(in.fn, l, r, &dst))
+                        return BinaryOpError(in.fn);
+                    break;
+                }
+
+                float x = WSLDB_NUMERIC_LITERAL(l);
+                float y = WSLDB_NUMERIC_LITERAL(r);
+                switch (in.fn) {
+                    case TokenType::Equal:          dst = Datum(x == y); break;
+                    case TokenType::NotEqual:       dst = Datum(x != y); break;
+                    case TokenType::Less:           dst = Datum(x < y); break;
+                    case TokenType::LessEqual:      dst = Datum(x <= y); break;
+                    case TokenType::Greater:        dst = Datum(x > y); break;
+                    case TokenType::GreaterEqual:   dst = Datum(x >= y); break;
+                    case TokenType::Plus:           dst = Datum(x + y); break;
+                    case TokenType::Minus:          dst = Datum(x - y); break;
+                    case TokenType::Star:           dst = Datum(x * y); break;
+                    case TokenType::Slash:          dst = Datum(x / y); break;
+                    default:
+                        return BinaryOpError(in.fn);
+                }
+                break;
+            }
+            case OpCode::BoolBinary: {
+                Datum& l = regs[in.a];
+                Datum& r = regs[in.b];
+                if (!l.IsType(DatumType::Bool) || !r.IsType(DatumType::Bool)) {
+                    if (!EvalBinaryOp(in.fn, l, r, &dst))
+                        return BinaryOpError(in.fn);
+                    break;
+                }
+
+                bool x = l.AsBool();
+                bool y = r.AsBool();
+                switch (in.fn) {
+                    case TokenType::And:            dst = Datum(x && y); break;
+                    case TokenType::Or:             dst = Datum(x || y); break;
+                    case TokenType::Equal:          dst = Datum(x == y); break;
+                    case TokenType::NotEqual:       dst = Datum(x != y); break;
+                    case TokenType::Less:           dst = Datum(x < y); break;
+                    case TokenType::LessEqual:      dst = Datum(x <= y); break;
+                    case TokenType::Greater:        dst = Datum(x > y); break;
+                    case TokenType::GreaterEqual:   dst = Datum(x >= y); break;
+                    default:
+                        return BinaryOpError(in.fn);
+                }
+                break;
+            }
+            case OpCode::TextBinary: {
+                Datum& l = regs[in.a];
+                Datum& r = regs[in.b];
+                if (!l.IsType(DatumType::Text) || !r.IsType(DatumType::Text)) {
+                    if (!EvalBinaryOp(in.fn, l, r, &dst))
+                        return BinaryOpError(in.fn);
+                    break;
+                }
+
+                //compare the shared bytes in place rather than copying both strings
+                int c = l.TextView().compare(r.TextView());
+                switch (in.fn) {
+                    case TokenType::Equal:          dst = Datum(c == 0); break;
+                    case TokenType::NotEqual:       dst = Datum(c != 0); break;
+                    case TokenType::Less:           dst = Datum(c < 0); break;
+                    case TokenType::LessEqual:      dst = Datum(c <= 0); break;
+                    case TokenType::Greater:        dst = Datum(c > 0); break;
+                    case TokenType::GreaterEqual:   dst = Datum(c >= 0); break;
+                    default:
+                        if (!EvalBinaryOp(in.fn, l, r, &dst))
+                            return BinaryOpError(in.fn);
+                        break;
+                }
+                break;
+            }
+            case OpCode::Binary: {
+                if (!EvalBinaryOp(in.fn, regs[in.a], regs[in.b], &dst))
+                    return BinaryOpError(in.fn);
+                break;
+            }
+            case OpCode::Unary: {
+                if (!EvalUnaryOp(in.fn, regs[in.a], &dst))
+                    return Status(false, "Error: Invalid unary operator");
+                break;
+            }
+            case OpCode::IsNull: {
+                dst = Datum(regs[in.a].IsType(DatumType::Null));
+                break;
+            }
+            case OpCode::Cast: {
+                if (!Datum::Cast(regs[in.a], in.type, &dst))
+                    return Status(false, "Execution Error: Casting of value failed");
+                break;
+            }
+            default:
+                return Status(false, "Execution Error: Invalid instruction");
+        }
+    }
+
+    *result = regs[program->result_];
+    return Status();
+}
+
+Status Executor::BinaryOpError(TokenType op) {
+    if (op == TokenType::Slash)
+        return Status(false, "Execution Error: Division by zero");
+    return Status(false, "Error: Invalid binary operator");
+}
+
+Status Executor::EvalTree(Expr* expr, Datum* result) {
     switch (expr->Type()) {
         case ExprType::Literal:
             return Eval((Literal*)expr, result);
@@ -167,33 +368,49 @@ Status Executor::CreateExecutor(CreateStmt* stmt) {
 
 
 Status Executor::InsertExecutor(InsertStmt* stmt) { 
-    for (std::vector<Expr*> exprs: stmt->col_assigns_) {
-        Status s = InsertRow(stmt->scan_, exprs);
-        if (!s.Ok()) return s;
-
-    }
-
-    return Status(); 
+    return InsertRows(stmt->scan_, stmt->col_assigns_);
 }
 
 Status Executor::UpdateExecutor(UpdateStmt* stmt) { 
-    BeginScan(stmt->scan_);
+    {
+        Status s = BeginScan(stmt->scan_);
+        if (!s.Ok())
+            return s;
+    }
 
-    Row* r;
-    int update_count = 0;
-    while (NextRow(stmt->scan_, &r).Ok()) {
+    //scans see the txn's own writes, so all rows (and their new values) are computed before any 
+    //are updated - otherwise updated keys could be scanned again
+    std::vector<Row*> rows;
+    std::vector<Row> updated_rows;
+    {
+        while (true) {
+            Row* r;
+            {
+                Status s = NextRow(stmt->scan_, &r);
+                if (!s.Ok())
+                    return s;
+                if (!r)
+                    break;
+            }
 
-        Row updated_row = *r;
+            Row updated_row = *r;
 
-        for (Expr* e: stmt->assigns_) {
-            Datum d;
-            Status s = PushEvalPop(e, &updated_row, stmt->scan_->output_attrs_, &d); //returned Datum of ColAssign expressions are ignored
+            for (Expr* e: stmt->assigns_) {
+                Datum d;
+                Status s = PushEvalPop(e, &updated_row, stmt->scan_->output_attrs_, &d); //returned Datum of ColAssign expressions are ignored
 
-            if (!s.Ok()) 
-                return s;
+                if (!s.Ok()) 
+                    return s;
+            }
+
+            rows.push_back(r);
+            updated_rows.push_back(updated_row);
         }
+    }
 
-        Status s = UpdateRow(stmt->scan_, r, &updated_row);
+    int update_count = 0;
+    for (size_t i = 0; i < rows.size(); i++) {
+        Status s = UpdateRow(stmt->scan_, rows.at(i), &updated_rows.at(i));
         if (!s.Ok()) return s;
 
         update_count++;
@@ -203,11 +420,26 @@ Status Executor::UpdateExecutor(UpdateStmt* stmt) {
 }
 
 Status Executor::DeleteExecutor(DeleteStmt* stmt) {
-    BeginScan(stmt->scan_);
+    {
+        Status s = BeginScan(stmt->scan_);
+        if (!s.Ok())
+            return s;
+    }
+
+    //rows are read before deleting so that the txn isn't written to while its iterator is in use
+    std::vector<Row*> rows;
+    while (true) {
+        Row* r;
+        Status s = NextRow(stmt->scan_, &r);
+        if (!s.Ok())
+            return s;
+        if (!r)
+            break;
+        rows.push_back(r);
+    }
 
-    Row* r;
     int delete_count = 0;
-    while (NextRow(stmt->scan_, &r).Ok()) {
+    for (Row* r: rows) {
         Status s = DeleteRow(stmt->scan_, r);
         if (!s.Ok()) return s;
         delete_count++;
@@ -215,11 +447,48 @@ Status Executor::DeleteExecutor(DeleteStmt* stmt) {
     return Status(); 
 }
 
-Status Executor::SelectExecutor(SelectStmt* stmt) {
+Status Executor::SelectExecutor(SelectStmt* stmt, RowSink* sink) {
     Status s = BeginScan(stmt->scan_);
-    RowSet* final_rs = new RowSet(((ProjectScan*)(stmt->scan_))->OutputAttributes());
-    Row* r;
-    while (NextRow(stmt->scan_, &r).Ok()) {
+    if (!s.Ok())
+        return s;
+
+    ProjectScan* project = (ProjectScan*)stmt->scan_;
+    if (sink) {
+        sink->BeginRows(project->OutputAttributes());
+
+        //an error part way through is sent after the rows already pushed, so the client never 
+        //mistakes a partial result for a complete one
+        size_t count = 0;
+        while (true) {
+            Row* r;
+            s = NextRow(stmt->scan_, &r);
+            if (!s.Ok())
+                return s;
+            if (!r)
+                break;
+
+            bool delivered = sink->PushRow(*r);
+            delete r;
+
+            if (!delivered)
+                return Status(false, "Execution Error: Client can no longer receive rows");
+
+            count++;
+        }
+
+        return Status(true, "(" + std::to_string(count) + " rows)");
+    }
+
+    RowSet* final_rs = new RowSet(project->OutputAttributes());
+    while (true) {
+        Row* r;
+        s = NextRow(stmt->scan_, &r);
+        if (!s.Ok()) {
+            delete final_rs;
+            return s;
+        }
+        if (!r)
+            break;
         final_rs->rows_.push_back(r);
     }
 
@@ -258,7 +527,7 @@ Status Executor::DropTableExecutor(DropTableStmt* stmt) {
         return Status(true, "(table '" + stmt->target_relation_.lexeme + "' doesn't exist and not dropped)");
     }
 
-    storage_->DropTable(stmt->schema_, *txn_);
+    storage_->DropTable(stmt->schema_.get(), *txn_);
 
     return Status(true, "(table '" + stmt->target_relation_.lexeme + "' dropped)");
 }
@@ -268,6 +537,7 @@ Status Executor::TxnControlExecutor(TxnControlStmt* stmt) {
     switch (stmt->t_.type) {
         case TokenType::Begin: {
             *txn_ = storage_->BeginTxn();
+            (*txn_)->is_explicit_ = true;
             return Status();
         }
         case TokenType::Commit: {
@@ -303,7 +573,11 @@ Status Executor::CreateModelExecutor(CreateModelStmt* stmt) {
         }
     }
 
-    return (*txn_)->Put(Storage::Models(), stmt->name_.lexeme, serialized_model);
+    //evicted again when the txn ends, since other connections may cache the committed model before then
+    Status s = (*txn_)->Put(Storage::Models(), stmt->name_.lexeme, serialized_model);
+    (*txn_)->AddModelWrite(inference_, stmt->name_.lexeme);
+    inference_->InvalidateModel(stmt->name_.lexeme);
+    return s;
 }
 
 //Analyzer should have returned error if table doesn't exist and 'if exists' not used
@@ -313,12 +587,173 @@ Status Executor::DropModelExecutor(DropModelStmt* stmt) {
     Status s = (*txn_)->Get(Storage::Models(), stmt->name_.lexeme, &serialized_model);
 
     if (s.Ok()) {
-        return (*txn_)->Delete(Storage::Models(), stmt->name_.lexeme);
+        s = (*txn_)->Delete(Storage::Models(), stmt->name_.lexeme);
+        (*txn_)->AddModelWrite(inference_, stmt->name_.lexeme);
+        inference_->InvalidateModel(stmt->name_.lexeme);
+        return s;
     }
 
     return Status();
 }
 
+//Bulk loads bypass the txn - rows are parsed in parallel, sorted by each index key and ingested
+//as sst files, so they are visible (and durable) as soon as the statement finishes.  Since ingested
+//rows can't be rolled back, COPY FROM can't be part of an explicit transaction
+Status Executor::CopyFromExecutor(CopyFromStmt* stmt) {
+    if ((*txn_)->is_explicit_)
+        return Status(false, "Error: COPY FROM cannot run inside a transaction block");
+
+    CopyFileMap file(stmt->path_.lexeme);
+    {
+        Status s = file.Open();
+        if (!s.Ok())
+            return s;
+    }
+    std::string_view buf = file.Data();
+
+    const Table* table = stmt->schema_.get();
+
+    //column 0 is _rowid, which is not included in copy files
+    std::vector<DatumType> types;
+    for (size_t i = 1; i < table->attrs_.size(); i++) {
+        types.push_back(table->attrs_.at(i).type);
+    }
+
+    std::vector<std::vector<Datum>> rows;
+    {
+        std::vector<CopyRecord> records;
+        Status s = SplitCopyRecords(buf, stmt->format_, &records);
+        if (!s.Ok())
+            return s;
+
+        s = ParseCopyRecords(buf, records, stmt->format_, types, &rows);
+        if (!s.Ok())
+            return s;
+    }
+
+    for (size_t i = 0; i < rows.size(); i++) {
+        std::vector<Datum>& data = rows.at(i);
+        for (size_t j = 0; j < types.size(); j++) {
+            if (table->not_null_constraints_.at(j + 1) && data.at(j).IsType(DatumType::Null))
+                return Status(false, "Execution Error: Row " + std::to_string(i + 1) + " of copy file has null in non-null column '" + 
+                                     table->attrs_.at(j + 1).name + "'");
+        }
+
+        int64_t rowid;
+        Status s = storage_->NextRowId(table->name_, &rowid);
+        if (!s.Ok())
+            return s;
+        data.insert(data.begin(), Datum(rowid));
+    }
+
+    //each index is encoded and sorted on its own thread, and duplicate keys in the file are 
+    //adjacent after sorting.  Primary index values are the rows, secondary index values are primary keys
+    std::vector<std::string> col_fams;
+    std::vector<std::vector<std::pair<std::string, std::string>>> sorted_kvs(table->idxs_.size());
+    std::vector<Status> statuses(table->idxs_.size());
+    {
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < table->idxs_.size(); i++) {
+            col_fams.push_back(table->idxs_.at(i).name_);
+            threads.emplace_back([&, i]() {
+                const Index& primary_idx = table->idxs_.at(0);
+                const Index& idx = table->idxs_.at(i);
+                std::vector<std::pair<std::string, std::string>>& kvs = sorted_kvs.at(i);
+                kvs.reserve(rows.size());
+                for (const std::vector<Datum>& data: rows) {
+                    if (i == 0) {
+                        kvs.emplace_back(idx.GetKeyFromFields(data), EncodeRow(data));
+                    } else {
+                        kvs.emplace_back(idx.GetKeyFromFields(data), primary_idx.GetKeyFromFields(data));
+                    }
+                }
+
+                std::sort(kvs.begin(), kvs.end(), [](const std::pair<std::string, std::string>& left,
+                                                     const std::pair<std::string, std::string>& right) {
+                    return left.first < right.first;
+                });
+
+                for (size_t j = 1; j < kvs.size(); j++) {
+                    if (kvs.at(j - 1).first == kvs.at(j).first) {
+                        statuses.at(i) = Status(false, i == 0 ? "Error: A record with the same primary key already exists" :
+                                                                "Error: A record with the same secondary key already exists");
+                        return;
+                    }
+                }
+            });
+        }
+
+        for (std::thread& thread: threads) {
+            thread.join();
+        }
+    }
+
+    for (Status& s: statuses) {
+        if (!s.Ok())
+            return s;
+    }
+
+    //keys must also be unique against rows already in the table.  Keys are checked against the latest
+    //committed rows and stay locked by the statement's txn until it commits after ingestion, so another
+    //txn can neither have committed the same key since our snapshot nor write it before the ssts land
+    for (size_t i = 0; i < table->idxs_.size(); i++) {
+        std::vector<std::string> keys;
+        keys.reserve(sorted_kvs.at(i).size());
+        for (const std::pair<std::string, std::string>& kv: sorted_kvs.at(i)) {
+            keys.push_back(kv.first);
+        }
+
+        std::vector<bool> found;
+        Status s = (*txn_)->MultiGetForUpdate(col_fams.at(i), keys, &found);
+        if (!s.Ok())
+            return s;
+
+        for (bool f: found) {
+            if (f)
+                return Status(false, i == 0 ? "Error: A record with the same primary key already exists" :
+                                              "Error: A record with the same secondary key already exists");
+        }
+    }
+
+    Status s = storage_->IngestSorted(col_fams, sorted_kvs);
+    if (!s.Ok())
+        return s;
+
+    return Status(true, "(" + std::to_string(rows.size()) + " rows copied)");
+}
+
+//rows are streamed from the query straight into the file sink, so exports use constant memory
+//unless the query itself needs to materialize rows (eg, order by)
+Status Executor::CopyToExecutor(CopyToStmt* stmt) {
+    CopyFileSink sink(stmt->path_.lexeme, stmt->format_);
+    Status s = sink.Open();
+    if (!s.Ok())
+        return s;
+
+    s = SelectExecutor(stmt->query_, &sink);
+    //a failed write stops the query, so report the write error rather than the query's
+    Status close_s = sink.Close();
+    if (!close_s.Ok())
+        return close_s;
+    if (!s.Ok())
+        return s;
+
+    return Status(true, "(" + std::to_string(sink.RowCount()) + " rows copied)");
+}
+
+//settings last for the rest of the connection, and aren't undone if the transaction rolls back
+Status Executor::SetExecutor(SetStmt* stmt) {
+    size_t value = std::stoll(stmt->value_.lexeme);
+    if (stmt->name_.lexeme == "memory_budget") {
+        settings_->memory_budget = value;
+        memory_budget_ = value;
+    } else {
+        settings_->predict_batch_size = value;
+    }
+
+    return Status(true, "(" + stmt->name_.lexeme + " set)");
+}
+
 /*
  * Expression Evaluators
  */
@@ -341,35 +776,29 @@ Status Executor::Eval(Binary* expr, Datum* result) {
         if (!s.Ok()) return s;
     }
 
-    if (l.IsType(DatumType::Null) || r.IsType(DatumType::Null)) {
-        *result = Datum();
-        return Status();
-    }
-
     switch (expr->op_.type) {
-        case TokenType::Equal:          *result = Datum(l == r); break;
-        case TokenType::NotEqual:       *result = Datum(l != r); break;
-        case TokenType::Less:           *result = Datum(l < r); break;
-        case TokenType::LessEqual:      *result = Datum(l <= r); break;
-        case TokenType::Greater:        *result = Datum(l > r); break;
-        case TokenType::GreaterEqual:   *result = Datum(l >= r); break;
-        case TokenType::Plus:           *result = Datum(l + r); break;
-        case TokenType::Minus:          *result = Datum(l - r); break;
-        case TokenType::Star:           *result = Datum(l * r); break;
-        case TokenType::Slash:          *result = Datum(l / r); break;
-        case TokenType::Or:             *result = Datum(l || r); break;
-        case TokenType::And:            *result = Datum(l && r);break;
         case TokenType::Similar:
         case TokenType::Like: {
-            bool s;
-            Matcher m(expr->op_.type == TokenType::Like ? Matcher::Type::Like : Matcher::Type::Similar, r.AsText(), &s);
-            if (!s)
-                return Status(false, "Execution Error: Invalid string matching pattern '" + r.AsText() + "'");
-            bool b = m.Match(l.AsText());
+            if (l.IsType(DatumType::Null) || r.IsType(DatumType::Null)) {
+                *result = Datum();
+                break;
+            }
+            if (!expr->matcher_ || expr->matcher_pattern_ != r.TextView()) {
+                bool s;
+                std::unique_ptr<Matcher> m = std::make_unique<Matcher>(expr->op_.type == TokenType::Like ? Matcher::Type::Like : Matcher::Type::Similar, r.AsText(), &s);
+                if (!s)
+                    return Status(false, "Execution Error: Invalid string matching pattern '" + r.AsText() + "'");
+                expr->matcher_ = std::move(m);
+                expr->matcher_pattern_ = r.AsText();
+            }
+            bool b = expr->matcher_->Match(l.AsText());
             *result = Datum(b);
             break;                
         }
-        default:                        return Status(false, "Error: Invalid binary operator");
+        default:
+            if (!EvalBinaryOp(expr->op_.type, l, r, result))
+                return BinaryOpError(expr->op_.type);
+            break;
     }
 
     return Status();
@@ -380,26 +809,18 @@ Status Executor::Eval(Unary* expr, Datum* result) {
     Status s = Eval(expr->right_, &right);
     if (!s.Ok()) return s;
 
-    switch (expr->op_.type) {
-        case TokenType::Minus: {
-                                   if (Datum::TypeIsInteger(right.Type())) {
-                                       *result = Datum(static_cast<int64_t>(-WSLDB_NUMERIC_LITERAL(right)));
-                                   } else {
-                                       *result = Datum(static_cast<float>(-WSLDB_NUMERIC_LITERAL(right)));
-                                   }
-                                   break;
-                               }
-        case TokenType::Not:
-                               *result = Datum(!right.AsBool());
-                               break;
-        default:
-                               return Status(false, "Error: Invalid unary operator");
-    }
+    if (!EvalUnaryOp(expr->op_.type, right, result))
+        return Status(false, "Error: Invalid unary operator");
 
     return Status();
 }
 
 Status Executor::Eval(ColRef* expr, Datum* result) {
+    if (expr->depth_ >= 0 && (size_t)expr->depth_ < attrs_.size() && attrs_.rbegin()[expr->depth_] == expr->scope_) {
+        *result = scopes_.rbegin()[expr->depth_]->data_[expr->idx_];
+        return Status();
+    }
+
     size_t i;
     int data_idx;
     {
@@ -428,7 +849,10 @@ Status Executor::Eval(ColAssign* expr, Datum* result) {
 
     size_t i;
     int data_idx;
-    {
+    if (expr->depth_ >= 0 && (size_t)expr->depth_ < attrs_.size() && attrs_.rbegin()[expr->depth_] == expr->scope_) {
+        i = expr->depth_;
+        data_idx = expr->idx_;
+    } else {
         for (i = 0; i < scopes_.size(); i++) {
             AttributeSet* as = attrs_.rbegin()[i];
             Attribute a;
@@ -456,46 +880,68 @@ Status Executor::Eval(ColAssign* expr, Datum* result) {
     return Status();
 }
 
+//aggregates are accumulated by HashAggregate, which sets the call's value before projecting each group
 Status Executor::Eval(Call* expr, Datum* result) {
-    Datum arg;
-    Status s = Eval(expr->arg_, &arg);
-    if (!s.Ok())
-        return s;
+    *result = expr->value_;
+    return Status();
+}
+
+//nulls are ignored by all aggregate functions
+bool Accumulator::Add(TokenType fcn, DatumType arg_type, Datum arg) {
+    if (arg.IsType(DatumType::Null))
+        return true;
 
-    switch (expr->fcn_.type) {
+    count++;
+
+    switch (fcn) {
         case TokenType::Avg:
-            expr->sum_ += arg;
-            expr->count_ += Datum(static_cast<int64_t>(1));
-            *result = expr->sum_ / expr->count_;
-            break;
-        case TokenType::Count: {
-            expr->count_ += Datum(static_cast<int64_t>(1));
-            *result = expr->count_;
-            break;
-        }
-        case TokenType::Max:
-            if (expr->first_ || arg > expr->max_) {
-                expr->max_ = arg;
-                expr->first_ = false;
+        case TokenType::Sum:
+            if (arg_type == DatumType::Int8) {
+                int_sum += arg.AsInt8();
+            } else if (arg_type == DatumType::Float4) {
+                float_sum += arg.AsFloat4();
+            } else {
+                return false;
             }
-            *result = expr->max_;
-            break;
+            return true;
+        case TokenType::Count:
+            return true;
+        case TokenType::Max:
+            if (extreme.IsType(DatumType::Null) || arg > extreme)
+                extreme = arg;
+            return true;
         case TokenType::Min:
-            if (expr->first_ || arg < expr->min_) {
-                expr->min_ = arg;
-                expr->first_ = false;
-            }
-            *result = expr->min_;
-            break;
-        case TokenType::Sum:
-            expr->sum_ += arg;
-            *result = expr->sum_;
-            break;
+            if (extreme.IsType(DatumType::Null) || arg < extreme)
+                extreme = arg;
+            return true;
         default:
-            return Status(false, "Error: Invalid function name");
+            return false;
     }
+}
 
-    return Status();
+//avg uses floor division if argument is an integer type
+Datum Accumulator::Result(TokenType fcn, DatumType arg_type) const {
+    if (fcn == TokenType::Count)
+        return Datum(count);
+
+    if (count == 0)
+        return Datum();
+
+    switch (fcn) {
+        case TokenType::Avg:
+            if (arg_type == DatumType::Int8)
+                return Datum(static_cast<int64_t>(int_sum / count));
+            return Datum(static_cast<float>(float_sum / count));
+        case TokenType::Sum:
+            if (arg_type == DatumType::Int8)
+                return Datum(int_sum);
+            return Datum(static_cast<float>(float_sum));
+        case TokenType::Max:
+        case TokenType::Min:
+            return extreme;
+        default:
+            return Datum();
+    }
 }
 
 Status Executor::Eval(IsNull* expr, Datum* result) {
@@ -535,6 +981,19 @@ Status Executor::Eval(ScalarSubquery* expr, Datum* result) {
 }
 
 Status Executor::Eval(Predict* expr, Datum* result) {
+    //a predict already run on the current batch reads back its result.  Batch state is kept on the
+    //projection rather than the expression, and the innermost projection is checked first
+    for (size_t i = batch_rows_.size(); i > 0; i--) {
+        ProjectScan* scan = batch_rows_.at(i - 1).first;
+        size_t row_idx = batch_rows_.at(i - 1).second;
+        for (size_t j = 0; j < scan->predicts_.size(); j++) {
+            if (scan->predicts_.at(j) == expr && row_idx < scan->batch_results_.at(j).size()) {
+                *result = scan->batch_results_.at(j).at(row_idx);
+                return Status();
+            }
+        }
+    }
+
     Datum d;
     {
         Status s = Eval(expr->arg_, &d);
@@ -542,16 +1001,9 @@ Status Executor::Eval(Predict* expr, Datum* result) {
             return s;
     }
 
-    std::string serialized_model;
-    {
-        Status s = (*txn_)->Get(Storage::Models(), expr->model_name_.lexeme, &serialized_model);
-        if (!s.Ok())
-            return Status(false, "Analysis Error: Model with the name '" + expr->model_name_.lexeme + "' does not exist");
-    }
-
-    Model* model;
+    std::shared_ptr<Model> model;
     {
-        Status s = inference_->DeserializeModel(serialized_model, &model);
+        Status s = inference_->GetModel(expr->model_name_.lexeme, *txn_, &model);
         if (!s.Ok())
             return s;
     }
@@ -597,6 +1049,8 @@ Status Executor::BeginScan(Scan* scan) {
             return BeginScan((ProductScan*)scan);
         case ScanType::OuterSelect:
             return BeginScan((OuterSelectScan*)scan);
+        case ScanType::HashJoin:
+            return BeginScan((HashJoinScan*)scan);
         case ScanType::Project:
             return BeginScan((ProjectScan*)scan);
         default:
@@ -610,179 +1064,750 @@ Status Executor::BeginScanConstant(ConstantScan* scan) {
 }
 
 Status Executor::BeginScanTable(TableScan* scan) {
-    scan->scan_idx_ = 0; //TODO: should change this if using index scan
-    scan->it_ = storage_->NewIterator(scan->table_->idxs_.at(scan->scan_idx_).name_);
-    scan->it_->SeekToFirst();
+    const Index* idx = &scan->table_->idxs_.at(scan->scan_idx_);
 
-    return Status();
-}
-
-Status Executor::BeginScan(SelectScan* scan) {
-    Status s = BeginScan(scan->scan_);
-    return s;
-}
+    //evaluate values for leading key columns (if analyzer found any) and seek to first matching key
+    std::vector<Datum> prefix_data;
+    scan->key_has_null_ = false;
+    for (size_t i = 0; i < scan->key_exprs_.size(); i++) {
+        Datum d;
+        Status s = EvalKeyField(scan->key_exprs_.at(i), scan->table_->attrs_.at(idx->key_idxs_.at(i)).type, &d);
+        if (!s.Ok())
+            return s;
 
-Status Executor::BeginScan(ProductScan* scan) {
-    {
-        Status s = BeginScan(scan->left_);
-        if (!s.Ok()) return s;
-    }
+        //comparisons with null are never true, so no records can pass the where clause
+        if (d.IsType(DatumType::Null)) {
+            scan->key_has_null_ = true;
+            break;
+        }
 
-    {
-        Status s = BeginScan(scan->right_);
-        if (!s.Ok()) return s;
+        prefix_data.push_back(d);
     }
 
-    return Status();
-}
+    scan->key_prefix_ = idx->GetKeyPrefix(prefix_data);
 
-Status Executor::BeginScan(OuterSelectScan* scan) {
-    {
-        Status s = BeginScan(scan->scan_);
-        if (!s.Ok()) return s;
-    }
+    //bounds on the key column following the prefix are inclusive - strict comparisons are handled by the where clause
+    std::string lower_key = scan->key_prefix_;
+    scan->upper_key_ = "";
+    if (scan->lower_expr_ || scan->upper_expr_) {
+        DatumType col_type = scan->table_->attrs_.at(idx->key_idxs_.at(prefix_data.size())).type;
+        for (Expr* e: { scan->lower_expr_, scan->upper_expr_ }) {
+            if (!e)
+                continue;
 
-    scan->scanning_rows_ = true;
+            Datum d;
+            Status s = EvalKeyField(e, col_type, &d);
+            if (!s.Ok())
+                return s;
+
+            if (d.IsType(DatumType::Null)) {
+                scan->key_has_null_ = true;
+                break;
+            }
+
+            if (e == scan->lower_expr_) {
+                lower_key += Index::EncodeKey(d);
+            } else {
+                scan->upper_key_ = scan->key_prefix_ + Index::EncodeKey(d);
+            }
+        }
+    }
+
+    if (scan->it_)
+        (*txn_)->DeleteIterator(scan->it_);
+    scan->it_ = (*txn_)->NewIterator(idx->name_);
+    if (lower_key.empty()) {
+        scan->it_->SeekToFirst();
+    } else {
+        scan->it_->Seek(lower_key);
+    }
 
     return Status();
 }
 
-Status Executor::BeginScan(ProjectScan* scan) {
-    scan->cursor_ = 0;
-    RowSet* rs = new RowSet(scan->output_attrs_->GetAttributes());
+//evaluates a value used to build an index key and casts it to the type of the key column
+Status Executor::EvalKeyField(Expr* expr, DatumType col_type, Datum* result) {
+    Status s = Eval(expr, result);
+    if (!s.Ok())
+        return s;
+
+    if (!result->IsType(DatumType::Null) && !result->IsType(col_type)) {
+        Datum casted;
+        if (!Datum::Cast(*result, col_type, &casted))
+            return Status(false, "Execution Error: Invalid cast");
+        *result = casted;
+    }
+
+    return Status();
+}
+
+Status Executor::BeginScan(SelectScan* scan) {
+    Status s = BeginScan(scan->scan_);
+    return s;
+}
+
+Status Executor::BeginScan(ProductScan* scan) {
     {
-        Status s = BeginScan(scan->input_);
+        Status s = BeginScan(scan->left_);
         if (!s.Ok()) return s;
+    }
 
+    {
+        Status s = BeginScan(scan->right_);
+        if (!s.Ok()) return s;
     }
 
+    delete scan->left_row_;
+    scan->left_row_ = nullptr;
+
+    return Status();
+}
+
+Status Executor::BeginScan(OuterSelectScan* scan) {
     {
-        Row* r;
-        Group* default_group = new Group(scan->input_attrs_, scan->projs_);
-        std::unordered_map<std::string, Group*> group_map;
-
-        while (NextRow(scan->input_, &r).Ok()) {
-            if (scan->group_cols_.size() > 0) {
-                std::string serialized_data;
-                for (Expr* e: scan->group_cols_) {
-                    Datum d;
-                    Status s = PushEvalPop(e, r, scan->input_attrs_, &d);
-                    if (!s.Ok()) return s;
-                    serialized_data += d.Serialize();
-                }
+        Status s = BeginScan(scan->scan_);
+        if (!s.Ok()) return s;
+    }
 
-                if (group_map.find(serialized_data) == group_map.end()) {
-                    group_map.insert({ serialized_data, new Group(scan->input_attrs_, scan->projs_) });
-                }
+    scan->scanning_rows_ = true;
 
-                Group* group = group_map.at(serialized_data);
+    return Status();
+}
 
-                group->data_.clear();
-                for (Expr* e: group->projs_) {
-                    Datum d;
-                    Status s = PushEvalPop(e, r, group->attrs_, &d);
-                    if (!s.Ok()) return s;
-                    group->data_.push_back(d);
-                }
+//Inputs are read in lockstep until one runs out - the exhausted (smaller) input is used to build
+//the hash table, and rows already read from the other input are probed before the rest of it is
+//streamed.  If the buffered rows exceed the memory budget first, both inputs are partitioned instead
+Status Executor::BeginScan(HashJoinScan* scan) {
+    //release anything left over from a previous scan
+    ReleaseHashJoin(scan);
+    for (size_t i = 0; i < scan->left_partitions_.size(); i++) {
+        scan->left_partitions_.at(i)->Close();
+        scan->right_partitions_.at(i)->Close();
+    }
+    scan->left_partitions_.clear();
+    scan->right_partitions_.clear();
+    scan->partition_ = 0;
+
+    {
+        Status s = BeginScan(scan->left_);
+        if (!s.Ok()) return s;
+    }
+
+    {
+        Status s = BeginScan(scan->right_);
+        if (!s.Ok()) return s;
+    }
+
+    //left rows are buffered in build_rows_ and right rows in probe_buffer_ until the smaller input is known
+    while (true) {
+        if (memory_used_ > memory_budget_)
+            return PartitionHashJoin(scan);
+
+        Row* row;
+        Status s = NextRow(scan->left_, &row);
+        if (!s.Ok())
+            return s;
+        if (!row) {
+            scan->build_left_ = true;
+            break;
+        }
+        size_t bytes = RowBytes(*row);
+        scan->charged_bytes_ += bytes;
+        memory_used_ += bytes;
+        scan->build_rows_.push_back(row);
+
+        s = NextRow(scan->right_, &row);
+        if (!s.Ok())
+            return s;
+        if (!row) {
+            scan->build_left_ = false;
+            break;
+        }
+        bytes = RowBytes(*row);
+        scan->charged_bytes_ += bytes;
+        memory_used_ += bytes;
+        scan->probe_buffer_.push_back(row);
+    }
+
+    if (!scan->build_left_)
+        std::swap(scan->build_rows_, scan->probe_buffer_);
+
+    return BuildHashTable(scan);
+}
+
+Status Executor::BuildHashTable(HashJoinScan* scan) {
+    scan->build_matched_ = std::vector<bool>(scan->build_rows_.size(), false);
+    scan->build_table_.clear();
+    scan->probe_matched_ = false;
+    scan->probe_done_ = false;
+    scan->matches_ = nullptr;
+    scan->match_idx_ = 0;
+    scan->unmatched_cursor_ = 0;
+
+    for (size_t i = 0; i < scan->build_rows_.size(); i++) {
+        std::string key;
+        bool has_null;
+        Status s = HashJoinKey(scan, scan->build_rows_.at(i), scan->build_left_, &key, &has_null);
+        if (!s.Ok())
+            return s;
+
+        //null keys never pass an equality, but the row is kept for outer joins
+        if (!has_null) {
+            scan->charged_bytes_ += key.size();
+            memory_used_ += key.size();
+            scan->build_table_[key].push_back(i);
+        }
+    }
+
+    return Status();
+}
+
+//Hashes every row of both inputs into partition files by join key, so rows that can match always
+//land in the same pair of partitions.  Rows with a null key never match, so any partition will do
+Status Executor::PartitionHashJoin(HashJoinScan* scan) {
+    for (int i = 0; i < SPILL_PARTITION_COUNT; i++) {
+        SpillFile* file;
+        Status s = NewSpillFile(&file);
+        if (!s.Ok()) return s;
+        scan->left_partitions_.push_back(file);
+
+        s = NewSpillFile(&file);
+        if (!s.Ok()) return s;
+        scan->right_partitions_.push_back(file);
+    }
+
+    for (bool left: {true, false}) {
+        std::vector<Row*>& buffered = left ? scan->build_rows_ : scan->probe_buffer_;
+        std::vector<SpillFile*>& partitions = left ? scan->left_partitions_ : scan->right_partitions_;
+        size_t cursor = 0;
+        while (true) {
+            Row* row;
+            if (cursor < buffered.size()) {
+                row = buffered.at(cursor);
+                buffered.at(cursor++) = nullptr;
             } else {
-                default_group->data_.clear();
-                for (Expr* e: default_group->projs_) {
-                    Datum d;
-                    Status s = PushEvalPop(e, r, default_group->attrs_, &d);
-                    if (!s.Ok()) return s;
-                    default_group->data_.push_back(d);
-                }
+                Status s = NextRow(left ? scan->left_ : scan->right_, &row);
+                if (!s.Ok()) return s;
+                if (!row)
+                    break;
+            }
+
+            std::string key;
+            bool has_null;
+            Status s = HashJoinKey(scan, row, left, &key, &has_null);
+            if (s.Ok()) {
+                size_t p = has_null ? 0 : std::hash<std::string>()(key) % SPILL_PARTITION_COUNT;
+                s = partitions.at(p)->Write(*row);
+            }
+            delete row;
+            if (!s.Ok()) return s;
+        }
+    }
+
+    return LoadPartition(scan, 0);
+}
+
+//Builds the hash table from the smaller side of partition p, and the other side is probed from its
+//file.  A partition that still doesn't fit in the memory budget is joined in memory anyway
+Status Executor::LoadPartition(HashJoinScan* scan, size_t p) {
+    ReleaseHashJoin(scan);
+    if (p > 0) {
+        scan->left_partitions_.at(p - 1)->Close();
+        scan->right_partitions_.at(p - 1)->Close();
+    }
+    scan->partition_ = p;
+
+    SpillFile* left = scan->left_partitions_.at(p);
+    SpillFile* right = scan->right_partitions_.at(p);
+    {
+        Status s = left->Rewind();
+        if (!s.Ok()) return s;
+        s = right->Rewind();
+        if (!s.Ok()) return s;
+    }
+
+    scan->build_left_ = left->RowCount() <= right->RowCount();
+    SpillFile* build = scan->build_left_ ? left : right;
+    while (true) {
+        Row* row;
+        Status s = build->Read(&row);
+        if (!s.Ok())
+            return s;
+        if (!row)
+            break;
+        size_t bytes = RowBytes(*row);
+        scan->charged_bytes_ += bytes;
+        memory_used_ += bytes;
+        scan->build_rows_.push_back(row);
+    }
 
-                if (!scan->has_agg_) {
-                    rs->rows_.push_back(new Row(default_group->data_));
+    return BuildHashTable(scan);
+}
+
+//frees the rows held by the join (or the current partition of it)
+void Executor::ReleaseHashJoin(HashJoinScan* scan) {
+    for (Row* row: scan->build_rows_) {
+        delete row;
+    }
+    scan->build_rows_.clear();
+    scan->build_table_.clear();
+    scan->matches_ = nullptr;
+
+    for (Row* row: scan->probe_buffer_) {
+        delete row;
+    }
+    scan->probe_buffer_.clear();
+    scan->probe_cursor_ = 0;
+
+    delete scan->probe_row_;
+    scan->probe_row_ = nullptr;
+
+    memory_used_ -= scan->charged_bytes_;
+    scan->charged_bytes_ = 0;
+}
+
+//buffered rows are probed first, then the rest of the probe input (or the probe side of the current partition)
+Status Executor::NextProbeRow(HashJoinScan* scan, Row** r) {
+    if (scan->probe_cursor_ < scan->probe_buffer_.size()) {
+        *r = scan->probe_buffer_.at(scan->probe_cursor_);
+        scan->probe_buffer_.at(scan->probe_cursor_++) = nullptr;
+        size_t bytes = RowBytes(**r);
+        scan->charged_bytes_ -= bytes;
+        memory_used_ -= bytes;
+        return Status();
+    }
+
+    if (!scan->left_partitions_.empty()) {
+        SpillFile* probe = scan->build_left_ ? scan->right_partitions_.at(scan->partition_) : scan->left_partitions_.at(scan->partition_);
+        return probe->Read(r);
+    }
+
+    return NextRow(scan->build_left_ ? scan->right_ : scan->left_, r);
+}
+
+Status Executor::HashJoinKey(HashJoinScan* scan, Row* row, bool left, std::string* key, bool* has_null) {
+    std::vector<int>& idxs = left ? scan->left_key_idxs_ : scan->right_key_idxs_;
+
+    //keys are always columns of the input, so they're read directly from the row
+    *key = "";
+    *has_null = false;
+    for (int idx: idxs) {
+        const Datum& d = row->data_.at(idx);
+        if (d.IsType(DatumType::Null)) {
+            *has_null = true;
+            return Status();
+        }
+
+        //memcomparable encoding is self-delimiting, so concatenated keys are unambiguous
+        *key += Index::EncodeKey(d);
+    }
+
+    return Status();
+}
+
+Status Executor::NewSpillFile(SpillFile** file) {
+    spill_files_.emplace_back(new SpillFile());
+    *file = spill_files_.back().get();
+    return (*file)->Open();
+}
+
+//Groups are numbered in the order they are first seen, and group i's accumulators are
+//accs[i * aggs_.size(), (i + 1) * aggs_.size()).  Only aggregate arguments are evaluated per input row - 
+//the projections are evaluated once per group, against the last row in the group.
+//Once the groups exceed the memory budget, rows that would start a new group are hashed into
+//partition files instead.  Groups already in memory are finished first, and then each partition is
+//aggregated on its own (and split again using the next bits of the hash if it still doesn't fit)
+Status Executor::HashAggregate(ProjectScan* scan, std::function<Status(Row**)> next_row, int depth) {
+    size_t agg_count = scan->aggs_.size();
+    std::vector<Row*> group_rows;
+    std::vector<Accumulator> accs;
+    std::unordered_map<std::string, size_t> group_idxs;
+    std::string key;
+    size_t group_bytes = 0;
+    std::vector<SpillFile*> partitions;
+
+    while (true) {
+        Row* r;
+        {
+            Status s = next_row(&r);
+            if (!s.Ok()) return s;
+            if (!r)
+                break;
+        }
+
+        size_t group_idx = 0;
+        if (!scan->group_cols_.empty()) {
+            key.clear();
+            for (Expr* e: scan->group_cols_) {
+                Datum d;
+                Status s = PushEvalPop(e, r, scan->input_attrs_, &d);
+                if (!s.Ok()) return s;
+                d.SerializeTo(&key);
+            }
+
+            std::unordered_map<std::string, size_t>::iterator it = group_idxs.find(key);
+            if (it != group_idxs.end()) {
+                group_idx = it->second;
+            } else if (!partitions.empty()) {
+                size_t p = (std::hash<std::string>()(key) >> (depth * 4)) % SPILL_PARTITION_COUNT;
+                Status s = partitions.at(p)->Write(*r);
+                delete r;
+                if (!s.Ok()) return s;
+                continue;
+            } else {
+                group_idx = group_rows.size();
+                group_idxs.insert({key, group_idx});
+                group_rows.push_back(nullptr);
+                accs.resize(accs.size() + agg_count);
+
+                size_t bytes = RowBytes(*r) + key.size() + agg_count * sizeof(Accumulator);
+                group_bytes += bytes;
+                memory_used_ += bytes;
+                if (memory_used_ > memory_budget_ && depth < SPILL_MAX_DEPTH) {
+                    for (int i = 0; i < SPILL_PARTITION_COUNT; i++) {
+                        SpillFile* file;
+                        Status s = NewSpillFile(&file);
+                        if (!s.Ok()) return s;
+                        partitions.push_back(file);
+                    }
                 }
             }
+        } else if (group_rows.empty()) {
+            group_rows.push_back(nullptr);
+            accs.resize(agg_count);
+        }
+
+        Accumulator* group_accs = accs.data() + group_idx * agg_count;
+        for (size_t i = 0; i < agg_count; i++) {
+            Call* call = scan->aggs_.at(i);
+            Datum arg;
+            Status s = PushEvalPop(call->arg_, r, scan->input_attrs_, &arg);
+            if (!s.Ok()) return s;
+
+            if (!group_accs[i].Add(call->fcn_.type, call->arg_type_, arg))
+                return Status(false, "Execution Error: Invalid argument type for '" + call->fcn_.lexeme + "'");
+        }
+
+        delete group_rows.at(group_idx);
+        group_rows.at(group_idx) = r;
+    }
+
+    //aggregating without 'group by' always produces a row, even if the input is empty
+    if (group_rows.empty() && scan->group_cols_.empty()) {
+        group_rows.push_back(new Row(std::vector<Datum>(scan->input_attrs_->AttributeCount(), Datum())));
+        accs.resize(agg_count);
+    }
+
+    group_idxs.clear();
+    for (size_t g = 0; g < group_rows.size(); g++) {
+        for (size_t i = 0; i < agg_count; i++) {
+            Call* call = scan->aggs_.at(i);
+            call->value_ = accs.at(g * agg_count + i).Result(call->fcn_.type, call->arg_type_);
+        }
+
+        std::vector<Datum> data;
+        for (Expr* e: scan->projs_) {
+            Datum d;
+            Status s = PushEvalPop(e, group_rows.at(g), scan->input_attrs_, &d);
+            if (!s.Ok()) return s;
+            data.push_back(d);
         }
 
-        if (scan->has_agg_ && scan->group_cols_.size() == 0) {
-            rs->rows_.push_back(new Row(default_group->data_));
+        delete group_rows.at(g);
+        group_rows.at(g) = nullptr;
+
+        Status s = BufferRow(scan, new Row(data));
+        if (!s.Ok()) return s;
+    }
+
+    memory_used_ -= group_bytes;
+
+    for (SpillFile* partition: partitions) {
+        Status s = partition->Rewind();
+        if (!s.Ok()) return s;
+
+        if (partition->RowCount() > 0) {
+            s = HashAggregate(scan, [partition](Row** r) -> Status { return partition->Read(r); }, depth + 1);
+            if (!s.Ok()) return s;
         }
 
-        for (std::unordered_map<std::string, Group*>::iterator it = group_map.begin(); it != group_map.end(); it++) {
-            rs->rows_.push_back(new Row(it->second->data_));
+        partition->Close();
+    }
+
+    return Status();
+}
+
+//Sort keys use the same order-preserving encoding as index keys, so nulls sort after all values
+//and a string sorts before any longer string it's a prefix of.  Each encoded field is
+//self-delimiting, so descending columns can just invert their bytes
+static void AppendSortKey(const Datum& d, bool asc, std::string* key) {
+    size_t start = key->size();
+    Index::AppendKey(d, key);
+
+    if (!asc) {
+        for (size_t i = start; i < key->size(); i++) {
+            key->at(i) = ~key->at(i);
         }
+    }
+}
 
+//order columns are projected, so the key is built from the row without evaluating any expressions
+static std::string SortKey(ProjectScan* scan, Row* row) {
+    std::string key;
+    for (const OrderCol& oc: scan->order_cols_) {
+        AppendSortKey(row->data_.at(oc.idx), oc.asc, &key);
     }
+    return key;
+}
+
+static bool SortRowLess(const SortRow& a, const SortRow& b) {
+    int c = a.key.compare(b.key);
+    return c < 0 || (c == 0 && a.seq < b.seq);
+}
 
+//Adds a projected row to the scan output, dropping it if it fails the 'having' clause.  If buffered
+//rows exceed the memory budget they're sorted and written to a run, and runs are merged in NextRow.
+//With a limit, only the best 'limit' rows seen so far are kept in a heap
+Status Executor::BufferRow(ProjectScan* scan, Row* row) {
     //'having' clause is pushed on as last ghost projection column (after any 'order' ghost columns)
-    if (scan->having_clause_) {
-        rs->rows_.erase(std::remove_if(rs->rows_.begin(), rs->rows_.end(),
-                        [](Row* r) -> bool {
-                            return !(r->data_.back().AsBool());
-                        }), 
-                        rs->rows_.end());
+    if (scan->having_clause_ && !row->data_.back().AsBool()) {
+        delete row;
+        return Status();
     }
 
-    //sort filtered rows in-place
-    if (!scan->order_cols_.empty()) {
-        //lambdas can only capture non-member variables
-        std::vector<OrderCol>& order_cols = scan->order_cols_;
-        AttributeSet* attrs = scan->output_attrs_;
-
-        std::sort(rs->rows_.begin(), rs->rows_.end(), 
-                //No error checking in lambda...
-                //do scope rows need to be pushed/popped of query state stack here???
-                [order_cols, this, attrs](Row* t1, Row* t2) -> bool { 
-                for (OrderCol oc: order_cols) {
-                    Datum d1;
-                    this->PushEvalPop(oc.col, t1, attrs, &d1);
-
-                    Datum d2;
-                    this->PushEvalPop(oc.col, t2, attrs, &d2);
-
-                    if (d1 == d2)
-                        continue;
-
-                    Row* r = nullptr;
-                    Datum d;
-                    this->PushEvalPop(oc.asc, r, attrs, &d);
-                    if (d.AsBool()) {
-                        return d1 < d2;
-                    }
-                    return d1 > d2;
-                }
+    SortRow sort_row = {SortKey(scan, row), scan->row_seq_++, row};
+
+    std::vector<SortRow>& buffer = scan->buffer_;
+    if (scan->top_n_ && buffer.size() >= scan->row_limit_) {
+        //the top of the heap is the last of the rows kept so far
+        if (buffer.empty() || !SortRowLess(sort_row, buffer.front())) {
+            delete row;
+            return Status();
+        }
+
+        //the evicted row's key was charged along with the row
+        std::pop_heap(buffer.begin(), buffer.end(), SortRowLess);
+        scan->charged_bytes_ -= buffer.back().key.size();
+        memory_used_ -= buffer.back().key.size();
+        ReleaseRow(scan, buffer.back().row);
+        buffer.pop_back();
+    }
+
+    size_t bytes = RowBytes(*row) + sort_row.key.size();
+    scan->charged_bytes_ += bytes;
+    memory_used_ += bytes;
+    buffer.push_back(sort_row);
+    if (scan->top_n_)
+        std::push_heap(buffer.begin(), buffer.end(), SortRowLess);
+
+    if (memory_used_ > memory_budget_)
+        return SpillRun(scan);
+
+    return Status();
+}
+
+void Executor::ReleaseRow(ProjectScan* scan, Row* row) {
+    size_t bytes = RowBytes(*row);
+    scan->charged_bytes_ -= bytes;
+    memory_used_ -= bytes;
+    delete row;
+}
+
+//Runs only hold rows - sort keys are rebuilt as the runs are read back
+Status Executor::SpillRun(ProjectScan* scan) {
+    std::vector<SortRow>& buffer = scan->buffer_;
+    if (buffer.empty())
+        return Status();
 
-                return true;
+    if (!scan->order_cols_.empty())
+        std::sort(buffer.begin(), buffer.end(), SortRowLess);
+
+    SpillFile* run;
+    Status s = NewSpillFile(&run);
+    if (!s.Ok()) return s;
+
+    for (const SortRow& sr: buffer) {
+        if (s.Ok())
+            s = run->Write(*sr.row);
+        delete sr.row;
+    }
+    buffer.clear();
+
+    memory_used_ -= scan->charged_bytes_;
+    scan->charged_bytes_ = 0;
+
+    scan->runs_.push_back(run);
+    return s;
+}
+
+Status Executor::ReadRunRow(ProjectScan* scan, size_t run) {
+    SortRow& sr = scan->run_rows_.at(run);
+    Status s = scan->runs_.at(run)->Read(&sr.row);
+    if (!s.Ok()) return s;
+
+    if (sr.row) {
+        sr.key = SortKey(scan, sr.row);
+    } else {
+        scan->runs_.at(run)->Close();
+    }
+
+    return Status();
+}
+
+//heap order for merging runs - earlier runs come first when rows are equal, so runs of unsorted
+//output are returned in the order they were written
+bool Executor::RunAfter(ProjectScan* scan, size_t a, size_t b) {
+    int c = scan->run_rows_.at(a).key.compare(scan->run_rows_.at(b).key);
+    return c > 0 || (c == 0 && a > b);
+}
+
+//Sorts, removes duplicates and limits the buffered output in place.  If any runs were spilled, the 
+//remaining rows are spilled too, and NextRow merges the runs instead
+Status Executor::FinishBuffer(ProjectScan* scan) {
+    if (!scan->runs_.empty()) {
+        Status s = SpillRun(scan);
+        if (!s.Ok()) return s;
+
+        scan->run_rows_.resize(scan->runs_.size(), {"", 0, nullptr});
+        for (size_t i = 0; i < scan->runs_.size(); i++) {
+            s = scan->runs_.at(i)->Rewind();
+            if (!s.Ok()) return s;
+            s = ReadRunRow(scan, i);
+            if (!s.Ok()) return s;
+            if (scan->run_rows_.at(i).row) {
+                scan->merge_heap_.push_back(i);
+            }
+        }
+
+        std::make_heap(scan->merge_heap_.begin(), scan->merge_heap_.end(), [this, scan](size_t a, size_t b) -> bool {
+                    return this->RunAfter(scan, a, b);
                 });
+        scan->distinct_keys_.clear();
+        return Status();
     }
 
+    //sort filtered rows in-place
+    std::vector<SortRow>& buffer = scan->buffer_;
+    if (!scan->order_cols_.empty())
+        std::sort(buffer.begin(), buffer.end(), SortRowLess);
 
-    //remove duplicates
-    scan->output_ = new RowSet(scan->output_attrs_->GetAttributes());
+    std::vector<Row*>& rows = scan->output_->rows_;
+    for (const SortRow& sr: buffer) {
+        scan->charged_bytes_ -= sr.key.size();
+        memory_used_ -= sr.key.size();
+        rows.push_back(sr.row);
+    }
+    buffer.clear();
 
+    //remove duplicates
     if (scan->distinct_) {
-        std::unordered_map<std::string, bool> map;
-        for (Row* r: rs->rows_) {
+        std::unordered_set<std::string> keys;
+        std::vector<Row*> distinct_rows;
+        for (Row* r: rows) {
             std::string key = Datum::SerializeData(r->data_);
-            if (map.find(key) == map.end()) {
-                map.insert({key, true});
-                scan->output_->rows_.push_back(r);
+            if (keys.insert(key).second) {
+                distinct_rows.push_back(r);
+            } else {
+                ReleaseRow(scan, r);
             }
         }
-    } else {
-        scan->output_->rows_ = rs->rows_;
+        rows = distinct_rows;
     }
 
     //limit in-place
-    Row dummy_row({});
-    Datum d;
+    if (scan->row_limit_ < rows.size()) {
+        for (size_t i = scan->row_limit_; i < rows.size(); i++) {
+            ReleaseRow(scan, rows.at(i));
+        }
+        rows.resize(scan->row_limit_);
+    }
+
+    return Status();
+}
+
+Status Executor::BeginScan(ProjectScan* scan) {
+    scan->cursor_ = 0;
+    {
+        Status s = BeginScan(scan->input_);
+        if (!s.Ok()) return s;
+
+    }
+
     //do rows need to be pushed/popped on query state row stack here?
     //should scalar subqueries be allowed in the limit clause?
     //nullptr for AttributeSet* argument since it's not necessary???
-    Status s = PushEvalPop(scan->limit_, &dummy_row, nullptr, &d);
-    if (!s.Ok()) return s;
+    {
+        Row dummy_row({});
+        Datum d;
+        Status s = PushEvalPop(scan->limit_, &dummy_row, nullptr, &d);
+        if (!s.Ok()) return s;
 
-    size_t limit = d == -1 ? std::numeric_limits<size_t>::max() : d.AsInt8();
-    if (limit < scan->output_->rows_.size()) {
-        scan->output_->rows_.resize(limit);
+        scan->row_limit_ = d == -1 ? std::numeric_limits<size_t>::max() : d.AsInt8();
     }
 
-    return Status();
+    //without grouping, aggregates or sorting each output row only depends on a single input row,
+    //so rows are projected one at a time in NextRow and the input is never materialized
+    scan->streaming_ = !scan->has_agg_ && scan->group_cols_.empty() && !scan->having_clause_ && scan->order_cols_.empty();
+    if (scan->streaming_) {
+        scan->distinct_keys_.clear();
+        for (size_t i = scan->batch_cursor_; i < scan->batch_.size(); i++) {
+            delete scan->batch_.at(i);
+        }
+        scan->batch_.clear();
+        scan->batch_cursor_ = 0;
+        return Status();
+    }
+
+    //release anything left over from a previous scan
+    memory_used_ -= scan->charged_bytes_;
+    scan->charged_bytes_ = 0;
+    for (const SortRow& sr: scan->run_rows_) {
+        delete sr.row;
+    }
+    for (SpillFile* run: scan->runs_) {
+        run->Close();
+    }
+    scan->runs_.clear();
+    scan->run_rows_.clear();
+    scan->merge_heap_.clear();
+    scan->buffer_.clear();
+    scan->row_seq_ = 0;
+
+    //with a limit only the first 'limit' rows in sort order need to be kept
+    scan->top_n_ = !scan->order_cols_.empty() && !scan->distinct_ && scan->row_limit_ != std::numeric_limits<size_t>::max();
+
+    scan->output_ = new RowSet(scan->output_attrs_->GetAttributes());
+
+    if (scan->has_agg_ || !scan->group_cols_.empty()) {
+        Status s = HashAggregate(scan, [this, scan](Row** r) -> Status {
+                    return this->NextRow(scan->input_, r);
+                }, 0);
+        if (!s.Ok()) return s;
+    } else {
+        while (true) {
+            Row* r;
+            {
+                Status s = NextRow(scan->input_, &r);
+                if (!s.Ok()) return s;
+                if (!r)
+                    break;
+            }
+
+            std::vector<Datum> data;
+            for (Expr* e: scan->projs_) {
+                Datum d;
+                Status s = PushEvalPop(e, r, scan->input_attrs_, &d);
+                if (!s.Ok()) return s;
+                data.push_back(d);
+            }
+            delete r;
+
+            Status s = BufferRow(scan, new Row(data));
+            if (!s.Ok()) return s;
+        }
+    }
+
+    return FinishBuffer(scan);
 }
 
 Status Executor::NextRow(Scan* scan, Row** row) {
@@ -797,6 +1822,8 @@ Status Executor::NextRow(Scan* scan, Row** row) {
             return NextRow((ProductScan*)scan, row);
         case ScanType::OuterSelect:
             return NextRow((OuterSelectScan*)scan, row);
+        case ScanType::HashJoin:
+            return NextRow((HashJoinScan*)scan, row);
         case ScanType::Project:
             return NextRow((ProjectScan*)scan, row);
         default:
@@ -805,8 +1832,10 @@ Status Executor::NextRow(Scan* scan, Row** row) {
 }
 
 Status Executor::NextRowConstant(ConstantScan* scan, Row** r) {
-    if (scan->cur_ > 0)
-        return Status(false, "No more rows");
+    if (scan->cur_ > 0) {
+        *r = nullptr;
+        return Status();
+    }
 
     std::vector<Datum> data;
     for (size_t i = 0; i < scan->target_cols_.size(); i++) {
@@ -819,19 +1848,28 @@ Status Executor::NextRowConstant(ConstantScan* scan, Row** r) {
 }
 
 Status Executor::NextRowTable(TableScan* scan, Row** r) {
-    if (!scan->it_->Valid()) return Status(false, "no more records");
+    *r = nullptr;
+    if (scan->key_has_null_ || !scan->it_->Valid() || !scan->it_->KeyHasPrefix(scan->key_prefix_)) 
+        return Status();
+
+    //past upper bound once key is greater than the bound and not an extension of it (other key columns)
+    if (!scan->upper_key_.empty() && !scan->it_->KeyHasPrefix(scan->upper_key_) && scan->it_->Key() > scan->upper_key_)
+        return Status();
 
-    std::string value = scan->it_->Value();
+    //decoded straight from the iterator's pinned value - datums copy what they keep
+    std::string_view value = scan->it_->ValueView();
   
     //if scan is using secondary index, value is primary key
     //return record stored in primary index
     int primary_cf = 0; 
+    std::string primary_value;
     if (scan->scan_idx_ != primary_cf) {
-        std::string primary_key = value;
-        (*txn_)->Get(scan->table_->idxs_.at(0).name_, primary_key, &value);
+        std::string primary_key(value);
+        (*txn_)->Get(scan->table_->idxs_.at(0).name_, primary_key, &primary_value);
+        value = primary_value;
     }
 
-    *r = new Row(scan->output_attrs_->DeserializeData(value));
+    *r = new Row(DecodeColumns(value, scan->table_->attrs_, scan->used_cols_));
     scan->it_->Next();
 
     return Status();
@@ -841,7 +1879,7 @@ Status Executor::NextRow(SelectScan* scan, Row** r) {
     while (true) {
         {
             Status s = NextRow(scan->scan_, r);
-            if (!s.Ok())
+            if (!s.Ok() || !*r)
                 return s;
         }
 
@@ -849,50 +1887,55 @@ Status Executor::NextRow(SelectScan* scan, Row** r) {
         {
             Status s = PushEvalPop(scan->expr_, *r, scan->output_attrs_, &result);
 
-            if (!s.Ok())
+            if (!s.Ok()) {
+                delete *r;
                 return s;
+            }
         }
 
         if (result.AsBool()) {
             return Status();
         }
-    }
 
-    return Status(false, "No more records");
+        delete *r;
+    }
 }
 
 Status Executor::NextRow(ProductScan* scan, Row** r) {
+    *r = nullptr;
     if (!scan->left_row_) {
         Status s = NextRow(scan->left_, &scan->left_row_);
-        if (!s.Ok())
-            return Status(false, "No more records");
+        if (!s.Ok() || !scan->left_row_)
+            return s;
     }
 
     Row* right_row;
     {
         Status s = NextRow(scan->right_, &right_row);
-        if (!s.Ok()) {
-            {
-                Status s2 = BeginScan(scan->right_);
-                if (!s2.Ok())
-                    return s;
-            }
-            {
-                Status s2 = NextRow(scan->left_, &scan->left_row_);
-                if (!s2.Ok())
-                    return Status(false, "No more records");
-            }
-            {
-                Status s2 = NextRow(scan->right_, &right_row);
-                if (!s2.Ok())
-                    return Status(false, "No more records");
-            }
-        }
-    }    
+        if (!s.Ok())
+            return s;
+    }
+
+    //right input is scanned again for each left row
+    if (!right_row) {
+        Status s = BeginScan(scan->right_);
+        if (!s.Ok())
+            return s;
+
+        delete scan->left_row_;
+        s = NextRow(scan->left_, &scan->left_row_);
+        if (!s.Ok() || !scan->left_row_)
+            return s;
+
+        s = NextRow(scan->right_, &right_row);
+        if (!s.Ok() || !right_row)
+            return s;
+    }
 
 
     std::vector<Datum> result = scan->left_row_->data_;
     result.insert(result.end(), right_row->data_.begin(), right_row->data_.end());
+    delete right_row;
     *r = new Row(result);
 
     return Status();
@@ -900,15 +1943,23 @@ Status Executor::NextRow(ProductScan* scan, Row** r) {
 
 
 Status Executor::NextRow(OuterSelectScan* scan, Row** r) {
-    while (NextRow(scan->scan_, r).Ok()) {
+    while (scan->scanning_rows_) {
+        {
+            Status s = NextRow(scan->scan_, r);
+            if (!s.Ok())
+                return s;
+            if (!*r)
+                break;
+        }
+
         std::string left_key;
         std::string right_key;
         for (size_t i = 0; i < (*r)->data_.size(); i++) {
             Datum& d = (*r)->data_.at(i);
             if (i < scan->scan_->left_->output_attrs_->AttributeCount()) {
-                left_key += d.Serialize();
+                d.SerializeTo(&left_key);
             } else {
-                right_key += d.Serialize();
+                d.SerializeTo(&right_key);
             } 
         }
 
@@ -933,6 +1984,8 @@ Status Executor::NextRow(OuterSelectScan* scan, Row** r) {
             scan->right_pass_table_.at(right_key) = true;
             return Status();
         }
+
+        delete *r;
     }
 
     if (scan->scanning_rows_) {
@@ -985,20 +2038,305 @@ Status Executor::NextRow(OuterSelectScan* scan, Row** r) {
         scan->right_it_++;
     }
 
-    return Status(false, "No more records");
+    *r = nullptr;
+    return Status();
+}
+
+Status Executor::NextRow(HashJoinScan* scan, Row** r) {
+    size_t left_count = scan->left_->output_attrs_->AttributeCount();
+    size_t right_count = scan->right_->output_attrs_->AttributeCount();
+
+    while (true) {
+        //the build side can differ between partitions
+        bool include_probe = scan->build_left_ ? scan->include_right_ : scan->include_left_;
+        bool include_build = scan->build_left_ ? scan->include_left_ : scan->include_right_;
+
+        //pair current probe row with build rows that have the same key
+        while (scan->matches_ && scan->match_idx_ < scan->matches_->size()) {
+            size_t build_idx = scan->matches_->at(scan->match_idx_++);
+            Row* left_row = scan->build_left_ ? scan->build_rows_.at(build_idx) : scan->probe_row_;
+            Row* right_row = scan->build_left_ ? scan->probe_row_ : scan->build_rows_.at(build_idx);
+
+            std::vector<Datum> data = left_row->data_;
+            data.insert(data.end(), right_row->data_.begin(), right_row->data_.end());
+            *r = new Row(data);
+
+            Datum result;
+            {
+                Status s = PushEvalPop(scan->expr_, *r, scan->output_attrs_, &result);
+                if (!s.Ok())
+                    return s;
+            }
+
+            if (result.AsBool()) {
+                scan->build_matched_.at(build_idx) = true;
+                scan->probe_matched_ = true;
+                return Status();
+            }
+
+            delete *r;
+        }
+
+        //unmatched probe row is padded with nulls if the join includes it
+        if (scan->probe_row_ && !scan->probe_matched_ && include_probe) {
+            std::vector<Datum> data;
+            if (scan->build_left_) {
+                data = std::vector<Datum>(left_count, Datum());
+                data.insert(data.end(), scan->probe_row_->data_.begin(), scan->probe_row_->data_.end());
+            } else {
+                data = scan->probe_row_->data_;
+                data.insert(data.end(), right_count, Datum());
+            }
+            delete scan->probe_row_;
+            scan->probe_row_ = nullptr;
+            *r = new Row(data);
+            return Status();
+        }
+
+        //output rows are copies, so the probe row isn't needed once its matches are returned
+        delete scan->probe_row_;
+        scan->probe_row_ = nullptr;
+        scan->matches_ = nullptr;
+
+        if (!scan->probe_done_) {
+            Status s = NextProbeRow(scan, &scan->probe_row_);
+            if (!s.Ok())
+                return s;
+            scan->probe_done_ = !scan->probe_row_;
+        }
+
+        if (scan->probe_row_) {
+            scan->probe_matched_ = false;
+            scan->match_idx_ = 0;
+
+            std::string key;
+            bool has_null;
+            Status s = HashJoinKey(scan, scan->probe_row_, !scan->build_left_, &key, &has_null);
+            if (!s.Ok())
+                return s;
+
+            if (!has_null) {
+                auto it = scan->build_table_.find(key);
+                if (it != scan->build_table_.end())
+                    scan->matches_ = &it->second;
+            }
+            continue;
+        }
+
+        //build rows that never matched are padded with nulls if the join includes them
+        while (include_build && scan->unmatched_cursor_ < scan->build_rows_.size()) {
+            size_t build_idx = scan->unmatched_cursor_++;
+            if (scan->build_matched_.at(build_idx))
+                continue;
+
+            Row* build_row = scan->build_rows_.at(build_idx);
+            std::vector<Datum> data;
+            if (scan->build_left_) {
+                data = build_row->data_;
+                data.insert(data.end(), right_count, Datum());
+            } else {
+                data = std::vector<Datum>(left_count, Datum());
+                data.insert(data.end(), build_row->data_.begin(), build_row->data_.end());
+            }
+            *r = new Row(data);
+            return Status();
+        }
+
+        if (scan->partition_ + 1 < scan->left_partitions_.size()) {
+            Status s = LoadPartition(scan, scan->partition_ + 1);
+            if (!s.Ok())
+                return s;
+            continue;
+        }
+
+        ReleaseHashJoin(scan);
+        *r = nullptr;
+        return Status();
+    }
 }
 
 Status Executor::NextRow(ProjectScan* scan, Row** r) {
+    if (scan->streaming_) {
+        //cursor_ counts rows returned so far, so the input scan stops as soon as the limit is reached
+        while (scan->cursor_ < scan->row_limit_) {
+            Row* input;
+            if (scan->predicts_.empty()) {
+                Status s = NextRow(scan->input_, &input);
+                if (!s.Ok() || !input) {
+                    *r = nullptr;
+                    return s;
+                }
+            } else {
+                if (scan->batch_cursor_ == scan->batch_.size()) {
+                    Status s = NextPredictBatch(scan);
+                    if (!s.Ok())
+                        return s;
+                    if (scan->batch_.empty()) {
+                        *r = nullptr;
+                        return Status();
+                    }
+                }
+
+                input = scan->batch_.at(scan->batch_cursor_);
+                batch_rows_.push_back({scan, scan->batch_cursor_++});
+            }
+
+            std::vector<Datum> data;
+            Status s;
+            for (Expr* e: scan->projs_) {
+                Datum d;
+                s = PushEvalPop(e, input, scan->input_attrs_, &d);
+                if (!s.Ok())
+                    break;
+                data.push_back(d);
+            }
+
+            if (!scan->predicts_.empty())
+                batch_rows_.pop_back();
+            delete input;
+            if (!s.Ok())
+                return s;
+
+            if (scan->distinct_) {
+                std::string key = Datum::SerializeData(data);
+                if (scan->distinct_keys_.find(key) != scan->distinct_keys_.end())
+                    continue;
+                scan->distinct_keys_.insert(key);
+            }
+
+            data.resize(data.size() - scan->ghost_column_count_);
+            *r = new Row(data);
+            scan->cursor_++;
+            return Status();
+        }
+
+        *r = nullptr;
+        return Status();
+    }
+
+    if (!scan->runs_.empty())
+        return NextMergedRow(scan, r);
+
+    //rows are handed over to the caller
     if (scan->cursor_ < scan->output_->rows_.size()) {
         *r = scan->output_->rows_.at(scan->cursor_);
+        scan->output_->rows_.at(scan->cursor_) = nullptr;
+
+        size_t bytes = RowBytes(**r);
+        scan->charged_bytes_ -= bytes;
+        memory_used_ -= bytes;
+
         (*r)->data_.resize((*r)->data_.size() - scan->ghost_column_count_);
         scan->cursor_++;
         return Status();
     }
 
-    return Status(false, "No more records");
+    *r = nullptr;
+    return Status();
+}
+
+//Returns the smallest of the next rows in each spilled run, applying 'distinct' and 'limit' as rows
+//are merged since the output was never materialized in one place
+Status Executor::NextMergedRow(ProjectScan* scan, Row** r) {
+    std::vector<size_t>& heap = scan->merge_heap_;
+    std::function<bool(size_t, size_t)> after = [this, scan](size_t a, size_t b) -> bool {
+        return this->RunAfter(scan, a, b);
+    };
+
+    while (scan->cursor_ < scan->row_limit_ && !heap.empty()) {
+        std::pop_heap(heap.begin(), heap.end(), after);
+        size_t run = heap.back();
+        heap.pop_back();
+
+        Row* row = scan->run_rows_.at(run).row;
+        Status s = ReadRunRow(scan, run);
+        if (!s.Ok()) {
+            delete row;
+            return s;
+        }
+
+        if (scan->run_rows_.at(run).row) {
+            heap.push_back(run);
+            std::push_heap(heap.begin(), heap.end(), after);
+        }
+
+        if (scan->distinct_) {
+            std::string key = Datum::SerializeData(row->data_);
+            if (!scan->distinct_keys_.insert(key).second) {
+                delete row;
+                continue;
+            }
+        }
+
+        row->data_.resize(row->data_.size() - scan->ghost_column_count_);
+        *r = row;
+        scan->cursor_++;
+        return Status();
+    }
+
+    *r = nullptr;
+    return Status();
 }
 
+//Pulls up to a batch of rows from the input and runs each model in the projection once on 
+//the whole batch.  Results are read back by Eval(Predict*) as each row is projected
+Status Executor::NextPredictBatch(ProjectScan* scan) {
+    scan->batch_.clear();
+    scan->batch_cursor_ = 0;
+
+    size_t batch_size = std::min(settings_->predict_batch_size, scan->row_limit_ - scan->cursor_);
+    while (scan->batch_.size() < batch_size) {
+        Row* r;
+        Status s = NextRow(scan->input_, &r);
+        if (!s.Ok())
+            return s;
+        if (!r)
+            break;
+        scan->batch_.push_back(r);
+    }
+
+    scan->batch_results_.assign(scan->predicts_.size(), std::vector<Datum>());
+    if (scan->batch_.empty())
+        return Status();
+
+    //predicts_ is in verification order, so any predict nested in an argument already has its results
+    for (size_t i = 0; i < scan->predicts_.size(); i++) {
+        Predict* p = scan->predicts_.at(i);
+
+        std::vector<std::string> bufs;
+        for (size_t row_idx = 0; row_idx < scan->batch_.size(); row_idx++) {
+            Datum d;
+            batch_rows_.push_back({scan, row_idx});
+            Status s = PushEvalPop(p->arg_, scan->batch_.at(row_idx), scan->input_attrs_, &d);
+            batch_rows_.pop_back();
+            if (!s.Ok())
+                return s;
+            bufs.push_back(d.Data());
+        }
+
+        std::shared_ptr<Model> model;
+        {
+            Status s = inference_->GetModel(p->model_name_.lexeme, *txn_, &model);
+            if (!s.Ok())
+                return s;
+        }
+
+        std::vector<int> results;
+        {
+            Status s = model->PredictBatch(bufs, results);
+            if (!s.Ok())
+                return s;
+        }
+
+        if (results.size() != bufs.size())
+            return Status(false, "Inference Error: Model did not return a result for each row");
+
+        for (int result: results)
+            scan->batch_results_.at(i).emplace_back(result);
+    }
+
+    return Status();
+}
 
 Status Executor::DeleteRow(Scan* scan, Row* r) {
     switch (scan->Type()) {
@@ -1018,14 +2356,14 @@ Status Executor::DeleteRow(SelectScan* scan, Row* r) {
 Status Executor::DeleteRow(TableScan* scan, Row* r) {
     //delete from primary index
     {
-        Index* primary_idx = &scan->table_->idxs_.at(0);
+        const Index* primary_idx = &scan->table_->idxs_.at(0);
         (*txn_)->Delete(primary_idx->name_, primary_idx->GetKeyFromFields(r->data_));
     }
 
     //delete key/value in all secondary indexes 
     {
         for (size_t i = 1; i < scan->table_->idxs_.size(); i++) {
-            Index* secondary_idx = &scan->table_->idxs_.at(i);
+            const Index* secondary_idx = &scan->table_->idxs_.at(i);
             (*txn_)->Delete(secondary_idx->name_, secondary_idx->GetKeyFromFields(r->data_));
         }
     }
@@ -1052,7 +2390,7 @@ Status Executor::UpdateRow(TableScan* scan, Row* old_r, Row* new_r) {
     //update primary index
     std::string updated_primary_key;
     {
-        Index* primary_idx = &scan->table_->idxs_.at(0);
+        const Index* primary_idx = &scan->table_->idxs_.at(0);
         std::string old_key = primary_idx->GetKeyFromFields(old_r->data_);
         updated_primary_key = primary_idx->GetKeyFromFields(new_r->data_);
 
@@ -1064,14 +2402,14 @@ Status Executor::UpdateRow(TableScan* scan, Row* old_r, Row* new_r) {
             (*txn_)->Delete(primary_idx->name_, old_key);
         }
 
-        (*txn_)->Put(primary_idx->name_, updated_primary_key, Datum::SerializeData(new_r->data_));
+        (*txn_)->Put(primary_idx->name_, updated_primary_key, EncodeRow(new_r->data_));
     }
 
     //update secondary indexes
     {
         std::string dummy_value;
         for (size_t i = 1; i < scan->table_->idxs_.size(); i++) {
-            Index* secondary_idx = &scan->table_->idxs_.at(i);
+            const Index* secondary_idx = &scan->table_->idxs_.at(i);
             std::string old_key = secondary_idx->GetKeyFromFields(old_r->data_);
             std::string updated_key = secondary_idx->GetKeyFromFields(new_r->data_);
 
@@ -1091,66 +2429,79 @@ Status Executor::UpdateRow(TableScan* scan, Row* old_r, Row* new_r) {
     return Status();
 }
 
-Status Executor::InsertRow(Scan* scan, const std::vector<Expr*>& exprs) {
+Status Executor::InsertRows(Scan* scan, const std::vector<std::vector<Expr*>>& col_assigns) {
     switch (scan->Type()) {
         case ScanType::Table:
-            return InsertRow((TableScan*)scan, exprs);
+            return InsertRows((TableScan*)scan, col_assigns);
         default:
             return Status(false, "Execution Error: Only table scans allow record insertion");
     }
 }
 
-Status Executor::InsertRow(TableScan* scan, const std::vector<Expr*>& exprs) {
-    //fill call fields with default null
-    std::vector<Datum> nulls;
-    for (size_t i = 0; i < scan->table_->attrs_.size(); i++) {
-        nulls.push_back(Datum());
-    }
+//all rows are evaluated before any are written so that uniqueness can be checked with one
+//MultiGet per index rather than a Get per row per index
+Status Executor::InsertRows(TableScan* scan, const std::vector<std::vector<Expr*>>& col_assigns) {
+    std::vector<Row> rows;
+    rows.reserve(col_assigns.size());
 
-    Row r(nulls);
+    for (const std::vector<Expr*>& exprs: col_assigns) {
+        //fill call fields with default null
+        rows.emplace_back(std::vector<Datum>(scan->table_->attrs_.size(), Datum()));
+        Row* r = &rows.back();
 
-    for (Expr* e: exprs) {
-        Datum d;
-        Status s = PushEvalPop(e, &r, scan->output_attrs_, &d); //result d is not used
-        if (!s.Ok()) return s;
-    }
+        for (Expr* e: exprs) {
+            Datum d;
+            Status s = PushEvalPop(e, r, scan->output_attrs_, &d); //result d is not used
+            if (!s.Ok()) return s;
+        }
 
-    //insert autoincrementing _rowid
-    {
-        //insertions will leave space at first index for _rowid
-        //TODO: this will NOT work if multiple txns try to use RowId at the same time - lost update problem here
-        //When schema is read, need to use GetForUpdate to prevent lost updates
-        int64_t rowid = scan->table_->NextRowId();
-        r.data_.at(0) = Datum(rowid);
+        //insert autoincrementing _rowid
+        {
+            //insertions will leave space at first index for _rowid
+            int64_t rowid;
+            Status s = storage_->NextRowId(scan->table_->name_, &rowid);
+            if (!s.Ok())
+                return s;
+            r->data_.at(0) = Datum(rowid);
+        }
     }
 
-    //insert into primary index
-    std::string primary_key;
-    {
+    //keys.at(i).at(j) is the key of row j in index i
+    std::vector<std::vector<std::string>> keys(scan->table_->idxs_.size());
+    for (size_t i = 0; i < scan->table_->idxs_.size(); i++) {
+        const Index* idx = &scan->table_->idxs_.at(i);
+        std::vector<std::string>& idx_keys = keys.at(i);
+        idx_keys.reserve(rows.size());
+
+        std::unordered_set<std::string> batch_keys;
+        for (const Row& r: rows) {
+            idx_keys.push_back(idx->GetKeyFromFields(r.data_));
+            if (!batch_keys.insert(idx_keys.back()).second)
+                return Status(false, i == 0 ? "Error: A record with the same primary key already exists" :
+                                              "Error: A record with the same secondary key already exists");
+        }
 
-        Index* primary_idx = &scan->table_->idxs_.at(0);
-        std::string value = Datum::SerializeData(r.data_);
-        primary_key = primary_idx->GetKeyFromFields(r.data_);
-        std::string test_value;
-        if ((*txn_)->Get(primary_idx->name_, primary_key, &test_value).Ok())
-            return Status(false, "Error: A record with the same primary key already exists");
+        std::vector<bool> found;
+        Status s = (*txn_)->MultiGet(idx->name_, idx_keys, &found);
+        if (!s.Ok())
+            return s;
 
-        (*txn_)->Put(primary_idx->name_, primary_key, value);
+        for (bool f: found) {
+            if (f)
+                return Status(false, i == 0 ? "Error: A record with the same primary key already exists" :
+                                              "Error: A record with the same secondary key already exists");
+        }
     }
 
-    //insert into secondary indexes
-    {
-        std::string test_value;
-        for (size_t i = 1; i < scan->table_->idxs_.size(); i++) {
-            Index* idx = &scan->table_->idxs_.at(i);
-            std::string secondary_key = idx->GetKeyFromFields(r.data_);
-            if ((*txn_)->Get(idx->name_, secondary_key, &test_value).Ok())
-                return Status(false, "Error: A record with the same secondary key already exists");
+    //insert into primary index, then secondary indexes
+    //the rocksdb txn buffers these in its write batch until commit
+    for (size_t j = 0; j < rows.size(); j++) {
+        const std::string& primary_key = keys.at(0).at(j);
+        (*txn_)->Put(scan->table_->idxs_.at(0).name_, primary_key, EncodeRow(rows.at(j).data_));
 
-            (*txn_)->Put(idx->name_, secondary_key, primary_key);
+        for (size_t i = 1; i < scan->table_->idxs_.size(); i++) {
+            (*txn_)->Put(scan->table_->idxs_.at(i).name_, keys.at(i).at(j), primary_key);
         }
-
-        (*txn_)->Put(Storage::Catalog(), scan->table_->name_, scan->table_->Serialize());
     }
 
     return Status();
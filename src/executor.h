@@ -1,51 +1,64 @@
 #pragma once
 
+#include <functional>
+#include <memory>
+
 #include "status.h"
 #include "expr.h"
 #include "stmt.h"
 #include "storage.h"
 #include "inference.h"
+#include "row_sink.h"
+#include "spill.h"
+#include "program.h"
+#include "settings.h"
 
 namespace wsldb {
 
 
-class Group {
-public:
-    Group(AttributeSet* attrs, const std::vector<Expr*>& projs): attrs_(attrs) {
-        for (Expr* e: projs) {
-            projs_.push_back(e->Clone());
-        }
-    }
-public:
-    AttributeSet* attrs_;
-    std::vector<Expr*> projs_;
-    std::vector<Datum> data_;
+//Running state of one aggregate call for one group.  Each group has a flat array of these,
+//one per aggregate call in the projection, so no expression state is cloned per group
+struct Accumulator {
+    bool Add(TokenType fcn, DatumType arg_type, Datum arg);
+    Datum Result(TokenType fcn, DatumType arg_type) const;
+
+    int64_t count {0};
+    int64_t int_sum {0};
+    double float_sum {0.0};
+    Datum extreme; //current min or max
 };
 
 
 class Executor {
 public:
-    Executor(Storage* storage, Inference* inference, Txn** txn): storage_(storage), inference_(inference), txn_(txn) {
+    Executor(Storage* storage, Inference* inference, Txn** txn, Settings* settings): 
+        storage_(storage), inference_(inference), txn_(txn), settings_(settings), memory_budget_(settings->memory_budget) {
         //ResetAggState();
     }
-    std::vector<Status> ExecuteQuery(const std::string& query);
+    std::vector<Status> ExecuteQuery(const std::string& query, RowSink* sink = nullptr);
 private:
-    Status Execute(Stmt* stmt);
+    Status Execute(Stmt* stmt, RowSink* sink = nullptr);
     //statements
     Status CreateExecutor(CreateStmt* stmt);
     Status InsertExecutor(InsertStmt* stmt);
     Status UpdateExecutor(UpdateStmt* stmt);
     Status DeleteExecutor(DeleteStmt* stmt);
-    Status SelectExecutor(SelectStmt* stmt);
+    Status SelectExecutor(SelectStmt* stmt, RowSink* sink);
     Status DescribeTableExecutor(DescribeTableStmt* stmt);
     Status DropTableExecutor(DropTableStmt* stmt);
     Status TxnControlExecutor(TxnControlStmt* stmt);
     Status CreateModelExecutor(CreateModelStmt* stmt);
     Status DropModelExecutor(DropModelStmt* stmt);
+    Status CopyFromExecutor(CopyFromStmt* stmt);
+    Status CopyToExecutor(CopyToStmt* stmt);
+    Status SetExecutor(SetStmt* stmt);
 
     //expressions
     Status PushEvalPop(Expr* expr, Row* row, AttributeSet* attrs, Datum* result);
     Status Eval(Expr* expr, Datum* result);
+    Status EvalTree(Expr* expr, Datum* result);
+    Status Run(Program* program, Datum* result);
+    Status BinaryOpError(TokenType op);
 
     Status Eval(Literal* expr, Datum* result);
     Status Eval(Binary* expr, Datum* result);
@@ -65,19 +78,39 @@ private:
     //TODO: these function names can be the same 'BeginScan' since the argument will overload it
     Status BeginScanConstant(ConstantScan* scan);
     Status BeginScanTable(TableScan* scan);
+    Status EvalKeyField(Expr* expr, DatumType col_type, Datum* result);
     Status BeginScan(SelectScan* scan);
     Status BeginScan(ProductScan* scan);
     Status BeginScan(OuterSelectScan* scan);
+    Status BeginScan(HashJoinScan* scan);
+    Status HashJoinKey(HashJoinScan* scan, Row* row, bool left, std::string* key, bool* has_null);
+    Status BuildHashTable(HashJoinScan* scan);
+    Status PartitionHashJoin(HashJoinScan* scan);
+    Status LoadPartition(HashJoinScan* scan, size_t p);
+    void ReleaseHashJoin(HashJoinScan* scan);
+    Status NextProbeRow(HashJoinScan* scan, Row** r);
     Status BeginScan(ProjectScan* scan);
+    Status HashAggregate(ProjectScan* scan, std::function<Status(Row**)> next_row, int depth);
+    Status BufferRow(ProjectScan* scan, Row* row);
+    Status SpillRun(ProjectScan* scan);
+    void ReleaseRow(ProjectScan* scan, Row* row);
+    Status FinishBuffer(ProjectScan* scan);
+    Status ReadRunRow(ProjectScan* scan, size_t run);
+    bool RunAfter(ProjectScan* scan, size_t a, size_t b);
+    Status NewSpillFile(SpillFile** file);
     
     //TODO: these function names can be the same 'NextRow' since the argument will overload it
+    //*r is set to nullptr with an ok status once all rows are returned - a failed status is a real error
     Status NextRow(Scan* scan, Row** r);
     Status NextRowConstant(ConstantScan* scan, Row** r);
     Status NextRowTable(TableScan* scan, Row** r);
     Status NextRow(SelectScan* scan, Row** r);
     Status NextRow(ProductScan* scan, Row** r);
     Status NextRow(OuterSelectScan* scan, Row** r);
+    Status NextRow(HashJoinScan* scan, Row** r);
     Status NextRow(ProjectScan* scan, Row** r);
+    Status NextMergedRow(ProjectScan* scan, Row** r);
+    Status NextPredictBatch(ProjectScan* scan);
 
     Status DeleteRow(Scan* scan, Row* r);
     Status DeleteRow(SelectScan* scan, Row* r);
@@ -87,15 +120,23 @@ private:
     Status UpdateRow(SelectScan* scan, Row* old_r, Row* new_r);
     Status UpdateRow(TableScan* scan, Row* old_r, Row* new_r);
 
-    Status InsertRow(Scan* scan, const std::vector<Expr*>& exprs);
-    Status InsertRow(TableScan* scan, const std::vector<Expr*>& exprs);
+    Status InsertRows(Scan* scan, const std::vector<std::vector<Expr*>>& col_assigns);
+    Status InsertRows(TableScan* scan, const std::vector<std::vector<Expr*>>& col_assigns);
 
 private:
     Storage* storage_;
     Inference* inference_;
     Txn** txn_;
+    Settings* settings_;
     std::vector<Row*> scopes_;
     std::vector<AttributeSet*> attrs_;
+    //rows buffered by sorts, aggregations and hash joins are charged against the budget, and spilled once it's exceeded
+    size_t memory_budget_;
+    size_t memory_used_ {0};
+    //projections evaluating a row of a predict batch, innermost last, and the index of the row in the batch
+    std::vector<std::pair<ProjectScan*, size_t>> batch_rows_;
+    //all temporary files used by the query - closed when the executor is destroyed, even if the query fails
+    std::vector<std::unique_ptr<SpillFile>> spill_files_;
 };
 
 }
@@ -1,6 +1,9 @@
 #pragma once
 
 #include <string>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
 
 #include "token.h"
 #include "datum.h"
@@ -8,11 +11,14 @@
 #include "table.h"
 #include "status.h"
 #include "iterator.h"
+#include "matcher.h"
 
 namespace wsldb {
 
 
 class Stmt;
+class SpillFile;
+class Program;
 
 enum class ExprType {
     Literal,
@@ -29,9 +35,13 @@ enum class ExprType {
 
 class Expr {
 public:
+    virtual ~Expr() {}
     virtual std::string ToString() = 0;
     virtual ExprType Type() const = 0;
     virtual Expr* Clone() const = 0;
+public:
+    DatumType datum_type_ {DatumType::Null}; //set by analyzer
+    Program* program_ {nullptr}; //compiled by analyzer for expressions evaluated once per row
 };
 
 class Literal: public Expr {
@@ -69,6 +79,9 @@ public:
     Token op_;
     Expr* left_;
     Expr* right_;
+    //compiled like/similar pattern - only recompiled if the pattern changes, and freed with the expression
+    std::unique_ptr<Matcher> matcher_;
+    std::string matcher_pattern_;
 };
 
 class Unary: public Expr {
@@ -104,10 +117,20 @@ public:
         return ExprType::ColRef;
     }
     Expr* Clone() const override {
-        return new ColRef(col_);
+        ColRef* cr = new ColRef(col_);
+        cr->depth_ = depth_;
+        cr->idx_ = idx_;
+        cr->scope_ = scope_;
+        return cr;
     }
 public:
     Column col_;
+    //set by analyzer - the column is idx_ in the row depth_ scopes out from the innermost one, which
+    //has attributes scope_.  The executor checks scope_ before using the binding, and looks the column
+    //up by name if the expression is evaluated against different attributes
+    int depth_ {-1};
+    int idx_ {-1};
+    AttributeSet* scope_ {nullptr};
 };
 
 
@@ -124,17 +147,32 @@ public:
     Expr* Clone() const override {
         ColAssign* ca = new ColAssign(col_, right_->Clone());
         ca->field_type_ = field_type_;
+        ca->depth_ = depth_;
+        ca->idx_ = idx_;
+        ca->scope_ = scope_;
         return ca;
     }
 public:
     Column col_;
     Expr* right_;
     DatumType field_type_ {DatumType::Null};
+    //column binding set by analyzer - same as ColRef
+    int depth_ {-1};
+    int idx_ {-1};
+    AttributeSet* scope_ {nullptr};
 };
 
 struct OrderCol {
     Expr* col;
-    Expr* asc;
+    bool asc;
+    int idx; //index of the projection column holding col's value - set by the analyzer
+};
+
+//a buffered output row, its memcomparable sort key, and its position in the output to keep sorts stable
+struct SortRow {
+    std::string key;
+    size_t seq;
+    Row* row;
 };
 
 struct Call: public Expr {
@@ -152,12 +190,9 @@ public:
 public:
     Token fcn_;
     Expr* arg_;
-
-    Datum min_ {Datum()};
-    Datum max_ {Datum()};
-    Datum sum_ {Datum(0)};
-    Datum count_ {Datum(0)};
-    bool first_ {true};
+    DatumType arg_type_ {DatumType::Null}; //set by analyzer
+    //aggregate state is kept by the executor - this is the final value for the group being projected
+    Datum value_ {Datum()};
 };
 
 class IsNull: public Expr {
@@ -232,7 +267,8 @@ enum class ScanType {
     Select,
     Product,
     OuterSelect,
-    Project
+    Project,
+    HashJoin
 };
 
 class Scan {
@@ -271,9 +307,21 @@ public:
 public:
     std::string tab_name_;
     std::string ref_name_;
-    Iterator* it_;
-    Table* table_;
+    Iterator* it_ {nullptr};
+    std::shared_ptr<const Table> table_;
     int scan_idx_ {0};
+    //set by analyzer when 'where' clause has equality predicates on leading columns of idxs_.at(scan_idx_)
+    //key_exprs_.at(i) is the value of the ith key column, and is evaluated once when scan begins
+    std::vector<Expr*> key_exprs_;
+    //optional inclusive bounds on the key column following key_exprs_
+    Expr* lower_expr_ {nullptr};
+    Expr* upper_expr_ {nullptr};
+    std::string key_prefix_;
+    std::string upper_key_;
+    bool key_has_null_ {false};
+    //set by analyzer - used_cols_.at(i) is true if column i is referenced anywhere in the query (or the
+    //whole row is needed, as in updates and deletes).  Only these columns are decoded, and the rest are left null
+    std::vector<bool> used_cols_;
 };
 
 class SelectScan: public Scan {
@@ -328,6 +376,54 @@ public:
     bool scanning_rows_;
 };
 
+//Chosen by the analyzer in place of SelectScan/OuterSelectScan over a ProductScan when the join 
+//predicate has equalities between columns of the left and right inputs.  The full predicate 
+//is still evaluated on every pair of rows with matching keys
+class HashJoinScan: public Scan {
+public:
+    HashJoinScan(Scan* left, Scan* right, Expr* expr, bool include_left, bool include_right, 
+                 std::vector<Expr*> left_keys, std::vector<Expr*> right_keys):
+        left_(left), right_(right), expr_(expr), include_left_(include_left), include_right_(include_right),
+        left_keys_(std::move(left_keys)), right_keys_(std::move(right_keys)) {}
+
+    ScanType Type() const override {
+        return ScanType::HashJoin;
+    }
+    bool IsUpdatable() const override {
+        return false;
+    }
+public:
+    Scan* left_;
+    Scan* right_;
+    Expr* expr_;
+    bool include_left_;
+    bool include_right_;
+    std::vector<Expr*> left_keys_;
+    std::vector<Expr*> right_keys_;
+    //column indexes of the keys in the left and right input rows
+    std::vector<int> left_key_idxs_;
+    std::vector<int> right_key_idxs_;
+
+    //execution state - hash table is built on whichever input is smaller
+    bool build_left_ {false};
+    std::vector<Row*> build_rows_;
+    std::vector<bool> build_matched_;
+    std::unordered_map<std::string, std::vector<size_t>> build_table_;
+    std::vector<Row*> probe_buffer_;
+    size_t probe_cursor_ {0};
+    Row* probe_row_ {nullptr};
+    bool probe_matched_ {false};
+    bool probe_done_ {false};
+    std::vector<size_t>* matches_ {nullptr};
+    size_t match_idx_ {0};
+    size_t unmatched_cursor_ {0};
+    size_t charged_bytes_ {0}; //memory charged for build_rows_ and probe_buffer_
+    //once the inputs exceed the memory budget, both are hashed into partition files by join key
+    //and each pair of partitions is joined on its own
+    std::vector<SpillFile*> left_partitions_;
+    std::vector<SpillFile*> right_partitions_;
+    size_t partition_ {0};
+};
 
 class ProjectScan: public Scan {
 public:
@@ -370,6 +466,21 @@ public:
     size_t cursor_ {0};
     int ghost_column_count_ {0};
     bool has_agg_ {false};
+    size_t row_limit_ {0};
+    bool streaming_ {false};
+    std::unordered_set<std::string> distinct_keys_;
+    std::vector<Predict*> predicts_;
+    std::vector<Call*> aggs_; //aggregate calls in projs_ (including ghost columns)
+    std::vector<Row*> batch_;
+    size_t batch_cursor_ {0};
+    std::vector<std::vector<Datum>> batch_results_; //results of predicts_.at(i) for each row in batch_
+    std::vector<SortRow> buffer_; //output rows before sorting, or a max-heap of the best rows for top-n
+    bool top_n_ {false};
+    size_t row_seq_ {0}; //rows buffered so far
+    size_t charged_bytes_ {0}; //memory charged for rows in buffer_ and output_
+    std::vector<SpillFile*> runs_; //sorted runs of output rows when buffer_ exceeded the memory budget
+    std::vector<SortRow> run_rows_; //next unread row of each run
+    std::vector<size_t> merge_heap_; //indexes of runs with unread rows, ordered by their next row
 };
 
 }
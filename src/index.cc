@@ -1,5 +1,9 @@
 #include "index.h"
 
+//tags used in front of each encoded key field
+//nulls sort after all non-null values, same as the postgres default of 'nulls last'
+#define WSLDB_KEY_NOT_NULL 0x01
+#define WSLDB_KEY_NULL 0x02
 
 namespace wsldb {
 
@@ -30,9 +34,84 @@ std::string Index::Serialize() const {
 std::string Index::GetKeyFromFields(const std::vector<Datum>& data) const {
     std::string primary_key;
     for (int i: key_idxs_) {
-        primary_key += data.at(i).Serialize();
+        primary_key += EncodeKey(data.at(i));
     }
     return primary_key;
 }
 
+//prefix_data holds values for the leading key columns only (in key column order)
+std::string Index::GetKeyPrefix(const std::vector<Datum>& prefix_data) const {
+    std::string prefix;
+    for (const Datum& d: prefix_data) {
+        prefix += EncodeKey(d);
+    }
+    return prefix;
+}
+
+//Order-preserving (memcomparable) encoding so that rocksdb's bytewise comparator
+//orders keys the same way Datum comparisons do.  Concatenated fields stay ordered
+//since each encoded field is self-delimiting
+std::string Index::EncodeKey(const Datum& d) {
+    std::string key;
+    AppendKey(d, &key);
+    return key;
+}
+
+void Index::AppendKey(const Datum& d, std::string* key) {
+    if (d.IsType(DatumType::Null)) {
+        key->push_back(WSLDB_KEY_NULL);
+        return;
+    }
+
+    key->push_back(WSLDB_KEY_NOT_NULL);
+
+    switch (d.Type()) {
+        case DatumType::Int8:
+        case DatumType::Timestamp: {
+            //flip sign bit so negative numbers sort first, then write big-endian
+            int64_t value = d.IsType(DatumType::Int8) ? d.AsInt8() : (int64_t)d.AsTimestamp();
+            uint64_t u = static_cast<uint64_t>(value) ^ (uint64_t(1) << 63);
+            for (int shift = 56; shift >= 0; shift -= 8) {
+                key->push_back(static_cast<char>((u >> shift) & 0xff));
+            }
+            break;
+        }
+        case DatumType::Float4: {
+            float f = d.AsFloat4();
+            if (f == 0.0f) //-0.0 and 0.0 compare equal, so they need the same key
+                f = 0.0f;
+
+            uint32_t bits;
+            memcpy(&bits, &f, sizeof(uint32_t));
+
+            //negative floats: invert all bits so larger magnitudes sort first
+            //positive floats: set sign bit so they sort after negatives
+            bits = (bits & 0x80000000) ? ~bits : (bits | 0x80000000);
+            for (int shift = 24; shift >= 0; shift -= 8) {
+                key->push_back(static_cast<char>((bits >> shift) & 0xff));
+            }
+            break;
+        }
+        case DatumType::Bool: {
+            key->push_back(d.AsBool() ? 0x01 : 0x00);
+            break;
+        }
+        case DatumType::Text:
+        case DatumType::Bytea: {
+            //escape 0x00 as 0x00 0xff and terminate with 0x00 0x01 so that a
+            //string sorts before any longer string it is a prefix of
+            for (char c: d.TextView()) {
+                key->push_back(c);
+                if (c == '\0')
+                    key->push_back(static_cast<char>(0xff));
+            }
+            key->push_back(0x00);
+            key->push_back(0x01);
+            break;
+        }
+        default:
+            break;
+    }
+}
+
 }
@@ -13,6 +13,10 @@ public:
     Index(const std::string& buf, int* offset);
     std::string Serialize() const;
     std::string GetKeyFromFields(const std::vector<Datum>& data) const;
+    std::string GetKeyPrefix(const std::vector<Datum>& prefix_data) const;
+    static std::string EncodeKey(const Datum& d);
+    //appends the same encoding as EncodeKey to the end of key
+    static void AppendKey(const Datum& d, std::string* key);
 public:
     std::string name_;
     std::vector<int> key_idxs_;
@@ -1,4 +1,6 @@
 #include "inference.h"
+#include "storage.h"
+#include "txn.h"
 
 #ifdef ML
 
@@ -77,6 +79,49 @@ Status Model::Predict(const std::string& buf, std::vector<int>& results) {
     return Status();
 }
 
+//Runs the input transform on each buffer, then a single forward pass on the stacked batch.  Stacking
+//only works if every transformed input is a single row of the same shape, and the results only line
+//up if the model returns one row per input row, so other models skip the batch and run one forward 
+//pass per buffer on the inputs that were already transformed
+Status Model::PredictBatch(const std::vector<std::string>& bufs, std::vector<int>& results) {
+    bool batchable = batchable_;
+    std::vector<torch::Tensor> inputs;
+    for (const std::string& buf: bufs) {
+        torch::Tensor data = torch::empty({ int64_t(buf.size()) }, torch::kByte);
+        memcpy(data.data_ptr(), buf.data(), buf.size());
+        torch::Tensor input = model_.run_method("wsldb_input", data).toTensor();
+
+        if (input.dim() == 0 || input.size(0) != 1 || (!inputs.empty() && input.sizes() != inputs.front().sizes()))
+            batchable = false;
+        inputs.push_back(input);
+    }
+
+    if (batchable) {
+        torch::Tensor output = model_.run_method("forward", torch::cat(inputs, 0)).toTensor();
+        output = model_.run_method("wsldb_output", output).toTensor();
+
+        if (output.size(0) == int64_t(bufs.size())) {
+            for (int i = 0; i < output.size(0); i++) {
+                results.push_back(output[i].item<int64_t>());
+            }
+            return Status();
+        }
+
+        batchable_ = false;
+    }
+
+    for (const torch::Tensor& input: inputs) {
+        torch::Tensor output = model_.run_method("forward", input).toTensor();
+        output = model_.run_method("wsldb_output", output).toTensor();
+        if (output.dim() == 0 || output.size(0) == 0)
+            return Status(false, "Inference Error: Model did not return a result for each row");
+
+        results.push_back(output[0].item<int64_t>());
+    }
+
+    return Status();
+}
+
 Status Inference::DeserializeModel(const std::string& serialized_model, Model** model) {
     try {
         std::stringstream ss(serialized_model);
@@ -90,4 +135,79 @@ Status Inference::DeserializeModel(const std::string& serialized_model, Model**
 
 }
 
+#else
+
+namespace wsldb {
+
+Status Inference::DeserializeModel(const std::string& serialized_model, Model** model) {
+    (void)serialized_model;
+    *model = new Model();
+    return Status();
+}
+
+}
+
 #endif
+
+namespace wsldb {
+
+//Returns cached model if present, otherwise loads and caches the latest committed model.  A txn that
+//created or dropped models itself sees its own uncommitted version, which is never cached
+Status Inference::GetModel(const std::string& name, Txn* txn, std::shared_ptr<Model>* model) {
+    if (txn->HasModelWrites()) {
+        std::string serialized_model;
+        Status s = txn->Get(Storage::Models(), name, &serialized_model);
+        if (!s.Ok())
+            return Status(false, "Execution Error: Model with the name '" + name + "' does not exist");
+
+        Model* m;
+        s = DeserializeModel(serialized_model, &m);
+        if (!s.Ok())
+            return s;
+        *model = std::shared_ptr<Model>(m);
+        return Status();
+    }
+
+    uint64_t version;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = models_.find(name);
+        if (it != models_.end()) {
+            *model = it->second;
+            return Status();
+        }
+        version = version_;
+    }
+
+    //deserializing is slow, so load without holding the lock.  Reading the latest committed model rather
+    //than the txn snapshot means an old snapshot can't cache a model that has since been replaced or dropped
+    std::string serialized_model;
+    {
+        Status s = txn->GetLatest(Storage::Models(), name, &serialized_model);
+        if (!s.Ok())
+            return Status(false, "Execution Error: Model with the name '" + name + "' does not exist");
+    }
+
+    Model* m;
+    {
+        Status s = DeserializeModel(serialized_model, &m);
+        if (!s.Ok())
+            return s;
+    }
+    *model = std::shared_ptr<Model>(m);
+
+    //only cache if no model was created/dropped while loading
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (version == version_)
+        models_.insert({name, *model});
+
+    return Status();
+}
+
+void Inference::InvalidateModel(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    version_++;
+    models_.erase(name);
+}
+
+}
@@ -8,6 +8,7 @@
 #include <string>
 #include <fstream>
 #include <vector>
+#include <atomic>
 
 #include "status.h"
 
@@ -17,6 +18,7 @@ class Model {
 public:
     Model(torch::jit::script::Module model);
     Status Predict(const std::string& buf, std::vector<int>& results);
+    Status PredictBatch(const std::vector<std::string>& bufs, std::vector<int>& results);
         
     inline caffe2::TypeMeta GetInputType() {
         return value_.dtype();
@@ -30,18 +32,11 @@ private:
     //caching value_ so that input types and sizes can be computed
     torch::Tensor value_;
     torch::jit::script::Module model_;
+    //cleared once the model is seen to not return one row per input row, so later batches skip straight
+    //to one forward pass per row.  Models are shared by all connections
+    std::atomic<bool> batchable_ {true};
 };
 
-class Inference {
-public:
-    Inference(const std::string& path): path_(path) {}
-    Status DeserializeModel(const std::string& deserialized_model, Model** model);
-    inline std::string CreateFullModelPath(const std::string& filename) const { return path_ + "/" + filename; }
-private:
-    std::string path_;
-};
-
-
 }
 
 #else
@@ -59,23 +54,40 @@ public:
         (void)results;
         return Status(); 
     }
-};
-
-class Inference {
-public:
-    Inference(const std::string& path) { 
-        (void)path; 
-    }
-    Status DeserializeModel(const std::string& serialized_model, Model** model) {
-        (void)serialized_model;
-        (void)model;
+    Status PredictBatch(const std::vector<std::string>& bufs, std::vector<int>& results) { 
+        (void)bufs;
+        (void)results;
         return Status(); 
     }
-    inline std::string CreateFullModelPath(const std::string& filename) const { 
-        (void)filename;
-        return "";
-    }
 };
 }
 
 #endif
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace wsldb {
+
+class Txn;
+
+//Shared by all connections.  Deserialized models are cached by name so that each model
+//is only loaded once, and entries are versioned so that a load racing with a 
+//CREATE/DROP MODEL never caches a stale model
+class Inference {
+public:
+    Inference(const std::string& path): path_(path) {}
+    Status DeserializeModel(const std::string& serialized_model, Model** model);
+    Status GetModel(const std::string& name, Txn* txn, std::shared_ptr<Model>* model);
+    void InvalidateModel(const std::string& name);
+    inline std::string CreateFullModelPath(const std::string& filename) const { return path_ + "/" + filename; }
+private:
+    std::string path_;
+    std::mutex mutex_;
+    uint64_t version_ {0}; //incremented on every CREATE/DROP MODEL
+    std::unordered_map<std::string, std::shared_ptr<Model>> models_;
+};
+
+}
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <string_view>
 
 #include "rocksdb/db.h"
 
@@ -22,9 +23,20 @@ public:
     std::string Value() {
         return it_->value().ToString();
     }
+    //points into the block pinned by the iterator, so it's only valid until the iterator moves
+    std::string_view ValueView() {
+        rocksdb::Slice value = it_->value();
+        return std::string_view(value.data(), value.size());
+    }
     void SeekToFirst() {
         it_->SeekToFirst();
     }
+    void Seek(const std::string& key) {
+        it_->Seek(key);
+    }
+    bool KeyHasPrefix(const std::string& prefix) {
+        return it_->key().starts_with(prefix);
+    }
 private:
     rocksdb::Iterator* it_;
 };
@@ -17,7 +17,11 @@ int main() {
     wsldb::Storage::CreateDatabase("/tmp/testdb");
     wsldb::Storage storage("/tmp/testdb");
 
-    wsldb::Server server(&storage, &inference);
+    wsldb::Settings settings;
+    settings.memory_budget = QUERY_MEMORY_BUDGET; //per query, before sorts and aggregations spill to disk
+    settings.predict_batch_size = PREDICT_BATCH_SIZE; //rows per PREDICT forward pass
+
+    wsldb::Server server(&storage, &inference, 128, 1024, settings); //listen backlog, max client connections
     server.Listen("3000");
 
 
@@ -1,8 +1,12 @@
+#pragma once
+
 #include <string>
 #include <vector>
 #include <unordered_map>
 #include <algorithm>
 #include <memory>
+#include <map>
+#include <cstdint>
 
 namespace wsldb {
 
@@ -15,44 +19,40 @@ public:
 
     Matcher(Type type, const std::string& pattern, bool* status) {
         Compiler c(pattern);
+        Nfa nfa;
         switch (type) {
             case Type::Like:
-                *status = c.CompileForLike(&nfa_);
+                *status = c.CompileForLike(&nfa);
                 break;
             case Type::Similar:
-                *status = c.CompileForSimilar(&nfa_);
+                *status = c.CompileForSimilar(&nfa);
                 break;
             default:
                 *status = false;
                 break;
         }
+
+        if (*status) {
+            Flatten(nfa);
+            ResetDfa();
+        }
     }
 
+    //runs the dfa, computing any transitions not yet in the table
     bool Match(const std::string& str) {
-        std::vector<NfaState*> current_states;
-        std::vector<NfaState*> visited;
-        AddNextState(nfa_.start, current_states, visited);
-
+        int state = start_;
         for (const char& c: str) {
-            std::vector<NfaState*> next_states;
-            for (NfaState* s: current_states) {
-                std::unordered_map<char, std::shared_ptr<NfaState>>::iterator it = s->symbol_transition.find(c);
-                std::unordered_map<char, std::shared_ptr<NfaState>>::iterator it_any = s->symbol_transition.find('_');
-                std::vector<NfaState*> placeholder;
-                if (it != s->symbol_transition.end()) {
-                    AddNextState(it->second, next_states, placeholder);
-                } else if (it_any != s->symbol_transition.end()) {
-                    AddNextState(it_any->second, next_states, placeholder);
-                }
-            }
-            current_states = next_states;
-        }
+            if (state == DEAD_STATE)
+                return false;
 
-        for (NfaState* s: current_states) {
-            if (s->is_end) return true;
+            uint8_t symbol = (uint8_t)c;
+            int next = transitions_.at(state * 256 + symbol);
+            if (next == UNKNOWN_STATE)
+                next = ComputeTransition(state, symbol);
+            state = next;
         }
 
-        return false;
+        return state != DEAD_STATE && accepting_.at(state);
     }
 
 private:
@@ -63,6 +63,7 @@ private:
             is_end(is_end), symbol_transition(st), epsilon_transitions(et) {}
     public:
         bool is_end;
+        bool any_symbol {false}; //symbol transition matches any character, so an escaped '_' stays literal
         std::unordered_map<char, std::shared_ptr<NfaState>> symbol_transition;
         std::vector<std::shared_ptr<NfaState>> epsilon_transitions;
     };
@@ -76,6 +77,7 @@ private:
                 return map.at(ptr);
 
             std::shared_ptr<NfaState> clone = std::make_shared<NfaState>(ptr->is_end);
+            clone->any_symbol = ptr->any_symbol;
 
             map.insert({ ptr, clone });
             for (const std::pair<const char, std::shared_ptr<NfaState>>& p: ptr->symbol_transition) {
@@ -126,11 +128,19 @@ private:
         bool CompileLikeBase(Nfa* nfa) {
             char c = NextChar();
             switch (c) {
-                case '%':   *nfa = MakeClosure(MakeSymbol('_')); return true;
-                case '_':   *nfa = MakeSymbol('_'); return true;
+                case '%':   *nfa = MakeClosure(MakeAnySymbol()); return true;
+                case '_':   *nfa = MakeAnySymbol(); return true;
+                case '\\':  return CompileEscape(nfa);
                 default:    *nfa = MakeSymbol(c); return true;
             }
         }
+        //a backslash makes the next character literal, and can't end the pattern
+        bool CompileEscape(Nfa* nfa) {
+            if (AtEnd())
+                return false;
+            *nfa = MakeSymbol(NextChar());
+            return true;
+        }
 
         //functions for 'similar to' matching
         bool CompileAlternation(Nfa* nfa) {
@@ -198,12 +208,19 @@ private:
             return true;
         }
         bool CompileAtomic(Nfa* nfa) {
+            //an empty group or alternative, e.g. '()' or 'a|'
+            if (AtEnd())
+                return false;
             switch (PeekChar()) {
                 case '(': {
                     NextChar();
                     size_t start = idx_;
                     while (!PeekChar(')')) {
-                        NextChar();
+                        if (AtEnd())
+                            return false;
+                        //an escaped ')' doesn't close the group
+                        if (NextChar() == '\\' && !AtEnd())
+                            NextChar();
                     }
                     size_t end = idx_;
                     NextChar();
@@ -212,11 +229,15 @@ private:
                 }
                 case '%': {
                     NextChar();
-                    *nfa = MakeClosure(MakeSymbol('_')); return true;
+                    *nfa = MakeClosure(MakeAnySymbol()); return true;
                 }
                 case '_': {
                     NextChar();
-                    *nfa = MakeSymbol('_'); return true;
+                    *nfa = MakeAnySymbol(); return true;
+                }
+                case '\\': {
+                    NextChar();
+                    return CompileEscape(nfa);
                 }
                 default: {
                     if (PeekDupChar() || PeekChar('|'))
@@ -249,7 +270,7 @@ private:
             return pattern_.at(idx_);
         }
         bool EatChar(char c) {
-            return NextChar() == c;
+            return !AtEnd() && NextChar() == c;
         }
         char NextChar() {
             return pattern_.at(idx_++);
@@ -297,6 +318,11 @@ private:
             AddSymbolTransition(start, end, symbol);
             return { start, end };
         }
+        Nfa MakeAnySymbol() {
+            Nfa nfa = MakeSymbol('_');
+            nfa.start->any_symbol = true;
+            return nfa;
+        }
         Nfa MakeConcat(Nfa first, Nfa second) {
             AddEpsilonTransition(first.end, second.start);
             first.end->is_end = false;
@@ -368,20 +394,138 @@ private:
         size_t idx_ {0};
     };    
 
-    void AddNextState(std::shared_ptr<NfaState> state, std::vector<NfaState*>& next_states, std::vector<NfaState*>& visited_states) {
-        if (!state->epsilon_transitions.empty()) {
-            for (std::shared_ptr<NfaState> s: state->epsilon_transitions) {
-                if (std::find(visited_states.begin(), visited_states.end(), s.get()) == visited_states.end()) {
-                    visited_states.push_back(s.get());
-                    AddNextState(s, next_states, visited_states);
+    //copies nfa into flat arrays indexed by state - each state has at most one symbol transition
+    void Flatten(const Nfa& nfa) {
+        std::unordered_map<NfaState*, int> ids;
+        std::vector<NfaState*> stack = { nfa.start.get() };
+        ids.insert({ nfa.start.get(), 0 });
+        std::vector<NfaState*> states = { nfa.start.get() };
+
+        while (!stack.empty()) {
+            NfaState* state = stack.back();
+            stack.pop_back();
+
+            std::vector<NfaState*> children;
+            for (const std::pair<const char, std::shared_ptr<NfaState>>& p: state->symbol_transition)
+                children.push_back(p.second.get());
+            for (std::shared_ptr<NfaState> p: state->epsilon_transitions)
+                children.push_back(p.get());
+
+            for (NfaState* child: children) {
+                if (ids.find(child) == ids.end()) {
+                    ids.insert({ child, states.size() });
+                    states.push_back(child);
+                    stack.push_back(child);
                 }
             }
-        } else {
-            next_states.push_back(state.get());
         }
+
+        symbols_ = std::vector<int>(states.size(), NO_SYMBOL);
+        symbol_targets_ = std::vector<int>(states.size(), -1);
+        epsilons_ = std::vector<std::vector<int>>(states.size());
+        ends_ = std::vector<bool>(states.size(), false);
+        for (size_t i = 0; i < states.size(); i++) {
+            NfaState* state = states.at(i);
+            ends_.at(i) = state->is_end;
+            for (const std::pair<const char, std::shared_ptr<NfaState>>& p: state->symbol_transition) {
+                symbols_.at(i) = state->any_symbol ? ANY_SYMBOL : (uint8_t)p.first;
+                symbol_targets_.at(i) = ids.at(p.second.get());
+            }
+            for (std::shared_ptr<NfaState> p: state->epsilon_transitions)
+                epsilons_.at(i).push_back(ids.at(p.get()));
+        }
+    }
+
+    //follows epsilon transitions - only states without epsilon transitions are kept in sets
+    void AddClosure(int state, std::vector<int>& set, std::vector<bool>& visited) {
+        if (epsilons_.at(state).empty()) {
+            set.push_back(state);
+            return;
+        }
+
+        for (int s: epsilons_.at(state)) {
+            if (!visited.at(s)) {
+                visited.at(s) = true;
+                AddClosure(s, set, visited);
+            }
+        }
+    }
+
+    int AddDfaState(std::vector<int> set) {
+        std::sort(set.begin(), set.end());
+        set.erase(std::unique(set.begin(), set.end()), set.end());
+        if (set.empty())
+            return DEAD_STATE;
+
+        std::map<std::vector<int>, int>::iterator it = dfa_ids_.find(set);
+        if (it != dfa_ids_.end())
+            return it->second;
+
+        bool accepting = false;
+        for (int s: set) {
+            if (ends_.at(s))
+                accepting = true;
+        }
+
+        int id = dfa_sets_.size();
+        dfa_ids_.insert({ set, id });
+        dfa_sets_.push_back(set);
+        accepting_.push_back(accepting);
+        transitions_.resize(transitions_.size() + 256, UNKNOWN_STATE);
+
+        return id;
+    }
+
+    void ResetDfa() {
+        dfa_sets_.clear();
+        dfa_ids_.clear();
+        accepting_.clear();
+        transitions_.clear();
+
+        std::vector<int> set;
+        std::vector<bool> visited(symbols_.size(), false);
+        AddClosure(0, set, visited);
+        start_ = AddDfaState(set);
+    }
+
+    int ComputeTransition(int state, uint8_t symbol) {
+        std::vector<int> next_set;
+        std::vector<bool> visited(symbols_.size(), false);
+        for (int s: dfa_sets_.at(state)) {
+            if (symbols_.at(s) == symbol || symbols_.at(s) == ANY_SYMBOL)
+                AddClosure(symbol_targets_.at(s), next_set, visited);
+        }
+
+        //pathological patterns could create a huge number of dfa states, so the table is rebuilt once it gets too big
+        if (dfa_sets_.size() >= MAX_DFA_STATES) {
+            std::vector<int> current = dfa_sets_.at(state);
+            ResetDfa();
+            state = AddDfaState(current);
+        }
+
+        int next = AddDfaState(next_set);
+        transitions_.at(state * 256 + symbol) = next;
+        return next;
     }
 private:
-    Nfa nfa_;
+    static constexpr int NO_SYMBOL = -1;
+    static constexpr int ANY_SYMBOL = 256;
+    static constexpr int UNKNOWN_STATE = -1;
+    static constexpr int DEAD_STATE = -2;
+    static constexpr size_t MAX_DFA_STATES = 4096;
+
+    //flattened nfa - state 0 is the start
+    std::vector<int> symbols_;
+    std::vector<int> symbol_targets_;
+    std::vector<std::vector<int>> epsilons_;
+    std::vector<bool> ends_;
+
+    //dfa built lazily from sets of nfa states, with 256 transitions per state in transitions_
+    std::vector<std::vector<int>> dfa_sets_;
+    std::map<std::vector<int>, int> dfa_ids_;
+    std::vector<bool> accepting_;
+    std::vector<int> transitions_;
+    int start_;
 };
 
 }
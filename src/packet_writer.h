@@ -0,0 +1,90 @@
+#pragma once
+
+#include <string>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <errno.h>
+
+#define PACKET_WRITER_FLUSH_SIZE 65536
+
+namespace wsldb {
+
+//Buffers outgoing packets for a connection so that a result set is sent with a few large writes
+//rather than one send per packet.  The buffer is flushed when it reaches PACKET_WRITER_FLUSH_SIZE
+//and when the 'Z' (ready for query) packet is written
+class PacketWriter {
+public:
+    PacketWriter(int fd): fd_(fd), failed_(false) {}
+
+    void Write(char type, const std::string& msg) {
+        char header[sizeof(char) + sizeof(int)];
+        int size = sizeof(int) + msg.size();
+        header[0] = type;
+        memcpy(header + sizeof(char), &size, sizeof(int));
+
+        //large payloads are sent straight from msg along with anything already buffered
+        if (msg.size() >= PACKET_WRITER_FLUSH_SIZE) {
+            struct iovec iov[3] = { { (void*)buf_.data(), buf_.size() },
+                                    { header, sizeof(header) },
+                                    { (void*)msg.data(), msg.size() } };
+            SendAll(iov, 3, type != 'Z');
+            buf_.clear();
+            return;
+        }
+
+        buf_.append(header, sizeof(header));
+        buf_ += msg;
+
+        if (type == 'Z' || buf_.size() >= PACKET_WRITER_FLUSH_SIZE) {
+            struct iovec iov[1] = { { (void*)buf_.data(), buf_.size() } };
+            SendAll(iov, 1, type != 'Z');
+            buf_.clear();
+        }
+    }
+
+    //true if any write to the socket failed, eg client disconnected
+    bool Failed() const {
+        return failed_;
+    }
+private:
+    //MSG_MORE lets the kernel coalesce partial flushes with the rest of the response
+    void SendAll(struct iovec* iov, int iov_count, bool more) {
+        if (failed_)
+            return;
+
+        int flags = MSG_NOSIGNAL | (more ? MSG_MORE : 0);
+        while (iov_count > 0) {
+            struct msghdr msg;
+            memset(&msg, 0, sizeof(msg));
+            msg.msg_iov = iov;
+            msg.msg_iovlen = iov_count;
+
+            ssize_t n = sendmsg(fd_, &msg, flags);
+            if (n < 0) {
+                if (errno == EINTR)
+                    continue;
+                failed_ = true;
+                return;
+            }
+
+            //skip fully written buffers and advance into partially written one
+            while (iov_count > 0 && size_t(n) >= iov->iov_len) {
+                n -= iov->iov_len;
+                iov++;
+                iov_count--;
+            }
+
+            if (iov_count > 0) {
+                iov->iov_base = (char*)iov->iov_base + n;
+                iov->iov_len -= n;
+            }
+        }
+    }
+private:
+    int fd_;
+    bool failed_;
+    std::string buf_;
+};
+
+}
@@ -264,6 +264,7 @@ Status Parser::ParsePrimaryScan(Scan** wt) {
 Status Parser::ParseBinaryScan(Scan** wt) {
     Scan* left = ParseScan(ParsePrimaryScan);
 
+    //joins are left-deep, so 'a join b on ... join c on ...' joins c with the result of joining a and b
     while (PeekToken().type == TokenType::Cross || 
            PeekToken().type == TokenType::Inner ||
            PeekToken().type == TokenType::Left ||
@@ -274,40 +275,40 @@ Status Parser::ParseBinaryScan(Scan** wt) {
             case TokenType::Cross: {
                 EatToken(TokenType::Join, "Parse Error: Expected keyword 'join' after keyword 'cross'");
                 Scan* right = ParseScan(ParsePrimaryScan);
-                *wt = new ProductScan(left, right);
-                return Status();
+                left = new ProductScan(left, right);
+                break;
             }
             case TokenType::Inner: {
                 EatToken(TokenType::Join, "Parse Error: Expected keyword 'join' after keyword 'inner'");
                 Scan* right = ParseScan(ParsePrimaryScan);
                 EatToken(TokenType::On, "Parse Error: Expected 'on' keyword and join predicate for inner joins");
                 Expr* on = ParseExpr(Base);
-                *wt = new SelectScan(new ProductScan(left, right), on);
-                return Status();
+                left = new SelectScan(new ProductScan(left, right), on);
+                break;
             }
             case TokenType::Left: {
                 EatToken(TokenType::Join, "Parse Error: Expected keyword 'join' after keyword 'left'");
                 Scan* right = ParseScan(ParsePrimaryScan);
                 EatToken(TokenType::On, "Parse Error: Expected 'on' keyword and join predicate for left joins");
                 Expr* on = ParseExpr(Base);
-                *wt = new OuterSelectScan(new ProductScan(left, right), on, true, false);
-                return Status();
+                left = new OuterSelectScan(new ProductScan(left, right), on, true, false);
+                break;
             }
             case TokenType::Right: {
                 EatToken(TokenType::Join, "Parse Error: Expected keyword 'join' after keyword 'right'");
                 Scan* right = ParseScan(ParsePrimaryScan);
                 EatToken(TokenType::On, "Parse Error: Expected 'on' keyword and join predicate for right joins");
                 Expr* on = ParseExpr(Base);
-                *wt = new OuterSelectScan(new ProductScan(left, right), on, false, true);
-                return Status();
+                left = new OuterSelectScan(new ProductScan(left, right), on, false, true);
+                break;
             }
             case TokenType::Full: {
                 EatToken(TokenType::Join, "Parse Error: Expected keyword 'join' after keyword 'full'");
                 Scan* right = ParseScan(ParsePrimaryScan);
                 EatToken(TokenType::On, "Parse Error: Expected 'on' keyword and join predicate for full joins");
                 Expr* on = ParseExpr(Base);
-                *wt = new OuterSelectScan(new ProductScan(left, right), on, true, true);
-                return Status();
+                left = new OuterSelectScan(new ProductScan(left, right), on, true, true);
+                break;
             }
             default:
                 return Status();
@@ -474,7 +475,7 @@ Status Parser::ParseStmt(Stmt** stmt) {
                     Expr* col = ParseExpr(Base);
                     Token asc = EatTokenIn(std::vector<TokenType>({TokenType::Asc, TokenType::Desc}), 
                                            "Parse Error: Expected either keyword 'asc' or 'desc' after column name");
-                    order_cols.push_back({col, asc.type == TokenType::Asc ? new Literal(true) : new Literal(false)});
+                    order_cols.push_back({col, asc.type == TokenType::Asc, -1});
                 } while (AdvanceIf(TokenType::Comma));
             }
 
@@ -569,12 +570,64 @@ Status Parser::ParseStmt(Stmt** stmt) {
             *stmt = new DescribeTableStmt(target);
             return Status();
         }
+        case TokenType::Copy: {
+            if (AdvanceIf(TokenType::LParen)) {
+                if (PeekToken().type != TokenType::Select)
+                    return Status(false, "Parse Error: Expected select statement after '('");
+
+                Stmt* query;
+                Status s = ParseStmt(&query);
+                if (!s.Ok())
+                    return s;
+
+                EatToken(TokenType::RParen, "Parse Error: Expected ')' after select statement");
+                EatToken(TokenType::To, "Parse Error: Expected keyword 'to' after query");
+                Token path = EatToken(TokenType::StringLiteral, "Parse Error: Expected file path after 'to'");
+
+                CopyFormat format = CopyFormat::Csv;
+                if (AdvanceIf(TokenType::Binary)) {
+                    format = CopyFormat::Binary;
+                } else {
+                    AdvanceIf(TokenType::Csv);
+                }
+
+                EatToken(TokenType::SemiColon, "Parse Error: Expected ';' at end of copy statement");
+
+                *stmt = new CopyToStmt((SelectStmt*)query, path, format);
+                return Status();
+            }
+
+            Token target = EatToken(TokenType::Identifier, "Parse Error: Expected table name after 'copy'");
+            EatToken(TokenType::From, "Parse Error: Expected keyword 'from' after table name");
+            Token path = EatToken(TokenType::StringLiteral, "Parse Error: Expected file path after 'from'");
+
+            CopyFormat format = CopyFormat::Csv;
+            if (AdvanceIf(TokenType::Binary)) {
+                format = CopyFormat::Binary;
+            } else {
+                AdvanceIf(TokenType::Csv);
+            }
+
+            EatToken(TokenType::SemiColon, "Parse Error: Expected ';' at end of copy statement");
+
+            *stmt = new CopyFromStmt(target, path, format);
+            return Status();
+        }
         case TokenType::Begin:
         case TokenType::Commit:
         case TokenType::Rollback:
             EatToken(TokenType::SemiColon, "Parse Error: Expected ';' at end of describe statement");
             *stmt = new TxnControlStmt(next);
             return Status();
+        case TokenType::Set: {
+            Token name = EatToken(TokenType::Identifier, "Parse Error: Expected setting name after 'set'");
+            EatToken(TokenType::Equal, "Parse Error: Expected '=' after setting name");
+            Token value = EatToken(TokenType::IntLiteral, "Parse Error: Expected integer value after '='");
+            EatToken(TokenType::SemiColon, "Parse Error: Expected ';' at end of set statement");
+
+            *stmt = new SetStmt(name, value);
+            return Status();
+        }
         default:
             return Status(false, "Parse Error: Invalid token");
     }
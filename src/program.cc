@@ -0,0 +1,145 @@
+#include "program.h"
+#include "expr.h"
+
+namespace wsldb {
+
+//returns false if the operator isn't valid for the operands (or an integer is divided by zero)
+bool EvalBinaryOp(TokenType op, Datum& l, Datum& r, Datum* result) {
+    if (l.IsType(DatumType::Null) || r.IsType(DatumType::Null)) {
+        *result = Datum();
+        return true;
+    }
+
+    switch (op) {
+        case TokenType::Equal:          *result = Datum(l == r); break;
+        case TokenType::NotEqual:       *result = Datum(l != r); break;
+        case TokenType::Less:           *result = Datum(l < r); break;
+        case TokenType::LessEqual:      *result = Datum(l <= r); break;
+        case TokenType::Greater:        *result = Datum(l > r); break;
+        case TokenType::GreaterEqual:   *result = Datum(l >= r); break;
+        case TokenType::Plus:           *result = Datum(l + r); break;
+        case TokenType::Minus:          *result = Datum(l - r); break;
+        case TokenType::Star:           *result = Datum(l * r); break;
+        case TokenType::Slash:
+            if (Datum::TypeIsInteger(l.Type()) && Datum::TypeIsInteger(r.Type()) && r.AsInt8() == 0)
+                return false;
+            *result = Datum(l / r);
+            break;
+        case TokenType::Or:             *result = Datum(l || r); break;
+        case TokenType::And:            *result = Datum(l && r); break;
+        default:                        return false;
+    }
+
+    return true;
+}
+
+bool EvalUnaryOp(TokenType op, Datum& right, Datum* result) {
+    if (right.IsType(DatumType::Null)) {
+        *result = Datum();
+        return true;
+    }
+
+    switch (op) {
+        case TokenType::Minus:
+            if (Datum::TypeIsInteger(right.Type())) {
+                //not WSLDB_NUMERIC_LITERAL, which promotes to float and loses precision past 2^24
+                *result = Datum(static_cast<int64_t>(-right.AsInt8()));
+            } else {
+                *result = Datum(static_cast<float>(-WSLDB_NUMERIC_LITERAL(right)));
+            }
+            return true;
+        case TokenType::Not:
+            *result = Datum(!right.AsBool());
+            return true;
+        default:
+            return false;
+    }
+}
+
+Program* Program::Compile(Expr* expr) {
+    Program* program = new Program();
+    program->result_ = program->Emit(expr);
+    return program;
+}
+
+int Program::NewReg() {
+    regs_.push_back(Datum());
+    return regs_.size() - 1;
+}
+
+void Program::Push(OpCode op, TokenType fn, DatumType type, int dst, int a, int b) {
+    code_.push_back({op, fn, type, dst, a, b});
+}
+
+//children are emitted before their parent, so the last instruction computes the result
+int Program::Emit(Expr* expr) {
+    switch (expr->Type()) {
+        case ExprType::Literal: {
+            Literal* literal = (Literal*)expr;
+            int dst = NewReg();
+            regs_.at(dst) = Datum(LiteralTokenToDatumType(literal->t_.type), literal->t_.lexeme);
+            return dst;
+        }
+        case ExprType::ColRef: {
+            int dst = NewReg();
+            exprs_.push_back(expr);
+            Push(OpCode::ColRef, TokenType::Eof, expr->datum_type_, dst, exprs_.size() - 1, 0);
+            return dst;
+        }
+        case ExprType::Binary: {
+            Binary* binary = (Binary*)expr;
+            //the pattern matcher is cached on the expression, so string matching is left to the tree
+            if (binary->op_.type == TokenType::Like || binary->op_.type == TokenType::Similar)
+                break;
+
+            int a = Emit(binary->left_);
+            int b = Emit(binary->right_);
+            DatumType left = binary->left_->datum_type_;
+            DatumType right = binary->right_->datum_type_;
+
+            OpCode op = OpCode::Binary;
+            if (Datum::TypeIsInteger(left) && Datum::TypeIsInteger(right)) {
+                op = OpCode::IntBinary;
+            } else if (Datum::TypeIsNumeric(left) && Datum::TypeIsNumeric(right)) {
+                op = OpCode::FloatBinary;
+            } else if (left == DatumType::Bool && right == DatumType::Bool) {
+                op = OpCode::BoolBinary;
+            } else if (left == DatumType::Text && right == DatumType::Text) {
+                op = OpCode::TextBinary;
+            }
+
+            int dst = NewReg();
+            Push(op, binary->op_.type, expr->datum_type_, dst, a, b);
+            return dst;
+        }
+        case ExprType::Unary: {
+            Unary* unary = (Unary*)expr;
+            int a = Emit(unary->right_);
+            int dst = NewReg();
+            Push(OpCode::Unary, unary->op_.type, expr->datum_type_, dst, a, 0);
+            return dst;
+        }
+        case ExprType::IsNull: {
+            int a = Emit(((IsNull*)expr)->left_);
+            int dst = NewReg();
+            Push(OpCode::IsNull, TokenType::Eof, DatumType::Bool, dst, a, 0);
+            return dst;
+        }
+        case ExprType::Cast: {
+            Cast* cast = (Cast*)expr;
+            int a = Emit(cast->value_);
+            int dst = NewReg();
+            Push(OpCode::Cast, TokenType::Eof, TypeTokenToDatumType(cast->type_.type), dst, a, 0);
+            return dst;
+        }
+        default:
+            break;
+    }
+
+    int dst = NewReg();
+    exprs_.push_back(expr);
+    Push(OpCode::Eval, TokenType::Eof, expr->datum_type_, dst, exprs_.size() - 1, 0);
+    return dst;
+}
+
+}
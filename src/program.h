@@ -0,0 +1,59 @@
+#pragma once
+
+#include <vector>
+
+#include "datum.h"
+#include "token.h"
+
+namespace wsldb {
+
+class Expr;
+
+//Int, Float, Bool and Text instructions are specialized on operand types found by the analyzer.  If
+//an operand turns out to have another type at runtime, the instruction falls back to the generic
+//Datum operators, so a compiled expression always gives the same result as the expression tree
+enum class OpCode {
+    ColRef,     //dst = value of column exprs_[a]
+    Eval,       //dst = exprs_[a] evaluated as a tree - aggregates, subqueries, predictions, like and assignments
+    IntBinary,  //dst = regs[a] fn regs[b] for two ints
+    FloatBinary,//dst = regs[a] fn regs[b] for numeric operands where at least one is a float
+    BoolBinary, //dst = regs[a] fn regs[b] for two bools
+    TextBinary, //dst = regs[a] fn regs[b] for two strings
+    Binary,     //dst = regs[a] fn regs[b] using the generic Datum operators
+    Unary,      //dst = fn regs[a]
+    IsNull,     //dst = regs[a] is null
+    Cast        //dst = regs[a] cast to type
+};
+
+struct Instr {
+    OpCode op;
+    TokenType fn;
+    DatumType type;
+    int dst;
+    int a;
+    int b;
+};
+
+//An expression tree flattened into instructions over registers.  Each node of the tree writes
+//its own register, and instructions are ordered so operands are computed before they're used,
+//so the program runs in a single pass without recursion.  Literals are parsed once when compiling
+//and stay in their registers
+class Program {
+public:
+    static Program* Compile(Expr* expr);
+public:
+    std::vector<Instr> code_;
+    std::vector<Expr*> exprs_;
+    std::vector<Datum> regs_;
+    int result_ {0};
+private:
+    int Emit(Expr* expr);
+    int NewReg();
+    void Push(OpCode op, TokenType fn, DatumType type, int dst, int a, int b);
+};
+
+//generic binary operators shared by Eval(Binary*) and compiled programs - null if either operand is null
+bool EvalBinaryOp(TokenType op, Datum& l, Datum& r, Datum* result);
+bool EvalUnaryOp(TokenType op, Datum& right, Datum* result);
+
+}
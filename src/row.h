@@ -1,5 +1,6 @@
 #pragma once
 
+#include <utility>
 #include <vector>
 
 #include "datum.h"
@@ -10,12 +11,12 @@ namespace wsldb {
 //Row will have either a single tuple (just the input row) or many (group row)
 class Row {
 public:
-    Row(std::vector<Datum> data): data_(data) {}
+    Row(std::vector<Datum> data): data_(std::move(data)) {}
     std::string Serialize() const {
         std::string ret;
 
         for (const Datum& d: data_) {
-            ret += d.Serialize();
+            d.SerializeTo(&ret);
         }
 
         return ret;
@@ -0,0 +1,256 @@
+#include <cstdint>
+
+#include "row_format.h"
+
+namespace wsldb {
+
+static void PutVarint(std::string* out, uint64_t v) {
+    while (v >= 0x80) {
+        out->push_back(static_cast<char>(v | 0x80));
+        v >>= 7;
+    }
+    out->push_back(static_cast<char>(v));
+}
+
+static uint64_t GetVarint(const char* p, const char* end) {
+    uint64_t v = 0;
+    for (int shift = 0; p < end && shift < 64; shift += 7) {
+        uint8_t byte = static_cast<uint8_t>(*p++);
+        v |= uint64_t(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+            break;
+    }
+    return v;
+}
+
+//small negative numbers get small encodings too: 0, -1, 1, -2, 2... map to 0, 1, 2, 3, 4...
+static uint64_t ZigZag(int64_t v) {
+    return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63);
+}
+
+static int64_t UnZigZag(uint64_t u) {
+    return static_cast<int64_t>(u >> 1) ^ -static_cast<int64_t>(u & 1);
+}
+
+static void PutColumn(std::string* out, const Datum& d) {
+    switch (d.Type()) {
+        case DatumType::Int8:
+            PutVarint(out, ZigZag(d.AsInt8()));
+            break;
+        case DatumType::Timestamp:
+            PutVarint(out, ZigZag(static_cast<int64_t>(d.AsTimestamp())));
+            break;
+        case DatumType::Float4: {
+            float f = d.AsFloat4();
+            out->append((char*)&f, sizeof(float));
+            break;
+        }
+        case DatumType::Bool:
+            out->push_back(d.AsBool() ? 1 : 0);
+            break;
+        case DatumType::Text:
+        case DatumType::Bytea: {
+            std::string_view bytes = d.TextView();
+            out->append(bytes.data(), bytes.size());
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+bool IsLegacyRow(std::string_view value) {
+    uint8_t version = value.empty() ? 0 : static_cast<uint8_t>(value[0]);
+    return version != ROW_FORMAT_V1 && version != ROW_FORMAT_V1_WIDE;
+}
+
+std::string EncodeRow(const std::vector<Datum>& data) {
+    size_t count = data.size();
+    size_t bitmap_size = (count + 7) / 8;
+    size_t offset_count = count > 0 ? count - 1 : 0;
+
+    //write column bytes after room for 16 bit offsets, and only rebuild the row in the rare case it needs wide ones
+    std::string value;
+    value.push_back(static_cast<char>(ROW_FORMAT_V1));
+    value.append(bitmap_size + offset_count * sizeof(uint16_t), '\0');
+    size_t body = value.size();
+
+    std::vector<uint32_t> ends;
+    ends.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        const Datum& d = data.at(i);
+        if (d.IsType(DatumType::Null))
+            value[1 + i / 8] |= static_cast<char>(1 << (i % 8));
+        PutColumn(&value, d);
+        ends.push_back(value.size() - body);
+    }
+
+    size_t body_size = value.size() - body;
+    if (body_size <= UINT16_MAX) {
+        for (size_t i = 0; i < offset_count; i++) {
+            uint16_t end = ends.at(i);
+            memcpy(&value[1 + bitmap_size + i * sizeof(uint16_t)], &end, sizeof(uint16_t));
+        }
+        return value;
+    }
+
+    std::string wide;
+    wide.reserve(1 + bitmap_size + offset_count * sizeof(uint32_t) + body_size);
+    wide.push_back(static_cast<char>(ROW_FORMAT_V1_WIDE));
+    wide.append(value, 1, bitmap_size);
+    for (size_t i = 0; i < offset_count; i++) {
+        uint32_t end = ends.at(i);
+        wide.append((char*)&end, sizeof(uint32_t));
+    }
+    wide.append(value, body, body_size);
+    return wide;
+}
+
+//where the parts of a version 1 row start
+struct RowLayout {
+    size_t count;
+    bool wide;
+    const char* bitmap;
+    const char* offsets;
+    const char* body;
+    size_t body_size;
+};
+
+static RowLayout ParseLayout(std::string_view value, size_t count) {
+    RowLayout layout;
+    layout.count = count;
+    layout.wide = static_cast<uint8_t>(value[0]) == ROW_FORMAT_V1_WIDE;
+    layout.bitmap = value.data() + 1;
+    layout.offsets = layout.bitmap + (count + 7) / 8;
+    size_t offset_width = layout.wide ? sizeof(uint32_t) : sizeof(uint16_t);
+    layout.body = layout.offsets + (count > 0 ? count - 1 : 0) * offset_width;
+    layout.body_size = value.data() + value.size() - layout.body;
+    return layout;
+}
+
+static size_t ColumnEnd(const RowLayout& layout, size_t i) {
+    if (i == layout.count - 1)
+        return layout.body_size;
+
+    if (layout.wide) {
+        uint32_t end;
+        memcpy(&end, layout.offsets + i * sizeof(uint32_t), sizeof(uint32_t));
+        return end;
+    }
+
+    uint16_t end;
+    memcpy(&end, layout.offsets + i * sizeof(uint16_t), sizeof(uint16_t));
+    return end;
+}
+
+static Datum DecodeV1Column(const RowLayout& layout, DatumType type, size_t idx) {
+    if (layout.bitmap[idx / 8] & (1 << (idx % 8)))
+        return Datum();
+
+    size_t start = idx == 0 ? 0 : ColumnEnd(layout, idx - 1);
+    size_t end = ColumnEnd(layout, idx);
+    const char* p = layout.body + start;
+
+    switch (type) {
+        case DatumType::Int8:
+            return Datum(UnZigZag(GetVarint(p, layout.body + end)));
+        case DatumType::Timestamp:
+            return Datum::FromTimestamp(static_cast<time_t>(UnZigZag(GetVarint(p, layout.body + end))));
+        case DatumType::Float4: {
+            float f;
+            memcpy(&f, p, sizeof(float));
+            return Datum(f);
+        }
+        case DatumType::Bool:
+            return Datum(*p != 0);
+        case DatumType::Text:
+        case DatumType::Bytea:
+            return Datum::FromBytes(type, p, end - start);
+        default:
+            return Datum();
+    }
+}
+
+//moves off past a legacy datum without copying its value
+static void SkipLegacyColumn(std::string_view value, int* off, DatumType type) {
+    bool is_null = value[*off];
+    *off += sizeof(bool);
+    if (is_null)
+        return;
+
+    switch (type) {
+        case DatumType::Int8:       *off += sizeof(int64_t); break;
+        case DatumType::Float4:     *off += sizeof(float); break;
+        case DatumType::Bool:       *off += sizeof(bool); break;
+        case DatumType::Timestamp:  *off += sizeof(time_t); break;
+        case DatumType::Text:
+        case DatumType::Bytea: {
+            int size;
+            memcpy(&size, value.data() + *off, sizeof(int));
+            *off += sizeof(int) + size;
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+std::vector<Datum> DecodeRow(std::string_view value, const std::vector<Attribute>& attrs) {
+    std::vector<Datum> data;
+    data.reserve(attrs.size());
+
+    if (IsLegacyRow(value)) {
+        int off = 0;
+        for (const Attribute& a: attrs) {
+            data.push_back(Datum(value, &off, a.type));
+        }
+        return data;
+    }
+
+    RowLayout layout = ParseLayout(value, attrs.size());
+    for (size_t i = 0; i < attrs.size(); i++) {
+        data.push_back(DecodeV1Column(layout, attrs.at(i).type, i));
+    }
+    return data;
+}
+
+std::vector<Datum> DecodeColumns(std::string_view value, const std::vector<Attribute>& attrs, const std::vector<bool>& used) {
+    std::vector<Datum> data(attrs.size());
+
+    if (IsLegacyRow(value)) {
+        //nothing after the last used column needs to be read
+        size_t last = attrs.size();
+        while (last > 0 && !used.at(last - 1))
+            last--;
+
+        int off = 0;
+        for (size_t i = 0; i < last; i++) {
+            if (used.at(i)) {
+                data.at(i) = Datum(value, &off, attrs.at(i).type);
+            } else {
+                SkipLegacyColumn(value, &off, attrs.at(i).type);
+            }
+        }
+        return data;
+    }
+
+    RowLayout layout = ParseLayout(value, attrs.size());
+    for (size_t i = 0; i < attrs.size(); i++) {
+        if (used.at(i))
+            data.at(i) = DecodeV1Column(layout, attrs.at(i).type, i);
+    }
+    return data;
+}
+
+Datum DecodeColumn(std::string_view value, const std::vector<Attribute>& attrs, int idx) {
+    if (!IsLegacyRow(value))
+        return DecodeV1Column(ParseLayout(value, attrs.size()), attrs.at(idx).type, idx);
+
+    int off = 0;
+    for (int i = 0; i < idx; i++) {
+        SkipLegacyColumn(value, &off, attrs.at(i).type);
+    }
+    return Datum(value, &off, attrs.at(idx).type);
+}
+
+}
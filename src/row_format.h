@@ -0,0 +1,35 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "datum.h"
+#include "attribute.h"
+
+//first byte of a versioned row value.  Rows written before versioning start with the bool null
+//flag of their first column instead, so any value starting with 0 or 1 is read as a legacy row
+#define ROW_FORMAT_V1 0x81
+//same as version 1, but with 32 bit column offsets for rows with more than 64KB of column bytes
+#define ROW_FORMAT_V1_WIDE 0x82
+
+namespace wsldb {
+
+//Values in a primary index, version 1:
+//  [version][null bitmap, one bit per column][end offset of each column except the last][column bytes]
+//Offsets are relative to the start of the column bytes, so column i spans from the end of column
+//i - 1 to its own end, and any column can be found without decoding the ones before it.  Int8 and
+//Timestamp are stored as zigzag varints, Float4 and Bool as their raw bytes, Text and Bytea as
+//their bytes with the length implied by the offsets, and nulls take no bytes at all.
+//
+//Legacy rows (Datum::SerializeData) are still read, and are rewritten in the new format the next
+//time they are updated
+std::string EncodeRow(const std::vector<Datum>& data);
+std::vector<Datum> DecodeRow(std::string_view value, const std::vector<Attribute>& attrs);
+//decodes only the columns where used.at(i) is true and leaves the others null
+std::vector<Datum> DecodeColumns(std::string_view value, const std::vector<Attribute>& attrs, const std::vector<bool>& used);
+//decodes a single column - legacy rows must skip over the columns before it
+Datum DecodeColumn(std::string_view value, const std::vector<Attribute>& attrs, int idx);
+bool IsLegacyRow(std::string_view value);
+
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <vector>
+
+#include "status.h"
+#include "row.h"
+
+namespace wsldb {
+
+//Receives statement results as the executor produces them, so a select result can be sent
+//to the client while the query runs rather than being collected in a RowSet first
+class RowSink {
+public:
+    virtual ~RowSink() {}
+    //called before the rows of a streamed select
+    virtual void BeginRows(const std::vector<Attribute>& attrs) = 0;
+    //blocks until the row is accepted - returns false if rows can no longer be delivered
+    virtual bool PushRow(const Row& row) = 0;
+    //called once per statement, including any result sets that were not streamed
+    virtual void EndStmt(Status s) = 0;
+};
+
+}
@@ -0,0 +1,96 @@
+#include "sequence.h"
+
+namespace wsldb {
+
+SequenceManager::~SequenceManager() {
+    for (std::pair<const std::string, Sequence*>& p: sequences_) {
+        delete p.second;
+    }
+}
+
+Status SequenceManager::NextValue(const std::string& name, int64_t* value) {
+    Sequence* seq = GetSequence(name);
+
+    int64_t id = seq->next.fetch_add(1);
+    if (id >= seq->limit.load()) {
+        std::lock_guard<std::mutex> lock(seq->mutex);
+        //another thread may have reserved a block while this one waited on the lock
+        int64_t limit = seq->limit.load();
+        if (id >= limit) {
+            int64_t new_limit = std::max(limit, id + 1) + SEQUENCE_BLOCK_SIZE;
+            Status s = Reserve(name, new_limit);
+            if (!s.Ok())
+                return s;
+            seq->limit.store(new_limit);
+        }
+    }
+
+    *value = id;
+    return Status();
+}
+
+//called when a table is created so that a table reusing a dropped table's name starts from 0
+Status SequenceManager::Reset(const std::string& name) {
+    Sequence* seq = GetSequence(name);
+    std::lock_guard<std::mutex> lock(seq->mutex);
+    Status s = Reserve(name, 0);
+    if (!s.Ok())
+        return s;
+    seq->limit.store(0);
+    seq->next.store(0);
+    return Status();
+}
+
+Status SequenceManager::AdvanceTo(const std::string& name, int64_t value) {
+    Sequence* seq = GetSequence(name);
+    std::lock_guard<std::mutex> lock(seq->mutex);
+    if (seq->limit.load() < value) {
+        Status s = Reserve(name, value);
+        if (!s.Ok())
+            return s;
+        seq->limit.store(value);
+    }
+
+    int64_t next = seq->next.load();
+    while (next < value && !seq->next.compare_exchange_weak(next, value)) {}
+    return Status();
+}
+
+//sequences are loaded from rocksdb the first time they are used
+SequenceManager::Sequence* SequenceManager::GetSequence(const std::string& name) {
+    {
+        std::shared_lock<std::shared_mutex> lock(map_mutex_);
+        std::unordered_map<std::string, Sequence*>::iterator it = sequences_.find(name);
+        if (it != sequences_.end())
+            return it->second;
+    }
+
+    std::unique_lock<std::shared_mutex> lock(map_mutex_);
+    std::unordered_map<std::string, Sequence*>::iterator it = sequences_.find(name);
+    if (it != sequences_.end())
+        return it->second;
+
+    int64_t limit = 0;
+    std::string value;
+    if (db_->Get(rocksdb::ReadOptions(), col_fam_, name, &value).ok())
+        limit = *((int64_t*)(value.data()));
+
+    Sequence* seq = new Sequence();
+    seq->next.store(limit);
+    seq->limit.store(limit);
+    sequences_.insert({ name, seq });
+
+    return seq;
+}
+
+Status SequenceManager::Reserve(const std::string& name, int64_t limit) {
+    std::string value;
+    value.append((char*)&limit, sizeof(int64_t));
+    rocksdb::Status s = db_->Put(rocksdb::WriteOptions(), col_fam_, name, value);
+    if (!s.ok())
+        return Status(false, "Execution Error: Failed to reserve sequence values for '" + name + "'");
+
+    return Status();
+}
+
+}
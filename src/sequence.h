@@ -0,0 +1,44 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+
+#include "rocksdb/db.h"
+#include "status.h"
+
+#define SEQUENCE_BLOCK_SIZE 1000
+
+namespace wsldb {
+
+//Allocates _rowid values for tables.  Each table has an in-memory atomic counter, and only the end
+//of the currently reserved block of ids is persisted in the sequences column family, so most 
+//allocations never touch rocksdb.  Sequences are not transactional - ids are never reused, even 
+//if the inserting txn rolls back, and ids left in a reserved block are skipped after a restart
+class SequenceManager {
+public:
+    SequenceManager(rocksdb::DB* db, rocksdb::ColumnFamilyHandle* col_fam): db_(db), col_fam_(col_fam) {}
+    virtual ~SequenceManager();
+    Status NextValue(const std::string& name, int64_t* value);
+    Status Reset(const std::string& name);
+    //makes sure no id less than value is handed out again - used when upgrading legacy catalog records
+    Status AdvanceTo(const std::string& name, int64_t value);
+private:
+    struct Sequence {
+        std::atomic<int64_t> next;
+        std::atomic<int64_t> limit; //ids less than limit are already reserved in rocksdb
+        std::mutex mutex; //only held while reserving a new block
+    };
+
+    Sequence* GetSequence(const std::string& name);
+    Status Reserve(const std::string& name, int64_t limit);
+private:
+    rocksdb::DB* db_;
+    rocksdb::ColumnFamilyHandle* col_fam_;
+    std::shared_mutex map_mutex_;
+    std::unordered_map<std::string, Sequence*> sequences_;
+};
+
+}
@@ -1,4 +1,6 @@
 #include <thread>
+#include <sys/epoll.h>
+#include <fcntl.h>
 
 #include "server.h"
 #include "executor.h"
@@ -15,54 +17,192 @@ void Server::SigChildHandler(int s) {
     errno = saved_errno;
 }
 
-void Server::ConnHandler(ConnHandlerArgs* args) {
-    std::cout << "handling connection\n";
-    Storage* storage = args->storage;
-    Inference* inference = args->inference;
-    int conn_fd = args->conn_fd;
-    free(args);
+void PacketSink::BeginRows(const std::vector<Attribute>& attrs) {
+    writer_->Write('T', RowSet(attrs).SerializeRowDescription());
+}
 
-    Txn* txn = nullptr;
+//PacketWriter blocks on the socket once its buffer is full, so a slow client throttles the executor
+bool PacketSink::PushRow(const Row& row) {
+    writer_->Write('D', row.Serialize());
+    return !writer_->Failed();
+}
 
-    while (true) {
-        std::string msg;
-        if (!Recv(conn_fd, msg)) {
-            break;
+void PacketSink::EndStmt(Status s) {
+    if (!s.Ok()) {
+        writer_->Write('E', s.Msg());
+        return;
+    }
+
+    for (RowSet* rs: s.Tuples()) {
+        writer_->Write('T', rs->SerializeRowDescription());
+
+        std::vector<std::string> data_rows = rs->SerializeDataRows();
+        for (const std::string& r: data_rows) {
+            writer_->Write('D', r);
         }
+    }
 
-        int len = *((int*)(msg.data() + sizeof(char)));
-        std::string query = msg.substr(sizeof(char) + sizeof(int), len - sizeof(int));
+    writer_->Write('C', s.Msg());
+}
 
-        Executor e(storage, inference, &txn);
+//Messages are [char type][int size, including itself][payload]
+static bool ValidMessageSize(int size) {
+    return size >= (int)sizeof(int) && sizeof(char) + (size_t)size <= MAX_MESSAGE_SIZE;
+}
 
-        std::vector<Status> ss = e.ExecuteQuery(query);
+//Size of the first message in buf if all of it has been received, or 0 if more bytes are needed.
+static size_t CompleteMessageSize(const std::string& buf) {
+    size_t header_size = sizeof(char) + sizeof(int);
+    if (buf.size() < header_size)
+        return 0;
 
-        for (Status s: ss) {
-            if (!s.Ok()) {
-                Send(conn_fd, PreparePacket('E', s.Msg()));
-            } else {
-                for (RowSet* rs: s.Tuples()) {
-                    std::string row_description = rs->SerializeRowDescription();
-                    Send(conn_fd, PreparePacket('T', row_description));
+    //invalid sizes are never complete, and the reactor closes the connection once it sees them
+    int size;
+    memcpy(&size, buf.data() + sizeof(char), sizeof(int));
+    if (!ValidMessageSize(size))
+        return 0;
 
-                    std::vector<std::string> data_rows = rs->SerializeDataRows();
-                    for (const std::string& r: data_rows) {
-                        Send(conn_fd, PreparePacket('D', r));
-                    }
-                }
+    size_t msg_size = sizeof(char) + size;
+    return buf.size() < msg_size ? 0 : msg_size;
+}
 
-                Send(conn_fd, PreparePacket('C', s.Msg()));
-            }
-        }
+//Moves the first message out of the connection's receive buffer if it has fully arrived
+static bool TakeMessage(Conn* conn, std::string* msg) {
+    size_t size = CompleteMessageSize(conn->recv_buf);
+    if (size == 0)
+        return false;
+
+    msg->assign(conn->recv_buf, 0, size);
+    conn->recv_buf.erase(0, size);
+    return true;
+}
+
+//Executes one query message from the client
+//Returns false if the results could not be sent because the client closed the connection
+bool Server::HandleQuery(Conn* conn, const std::string& msg) {
+    int len = *((int*)(msg.data() + sizeof(char)));
+    std::string query = msg.substr(sizeof(char) + sizeof(int), len - sizeof(int));
+
+    PacketWriter writer(conn->fd);
+    PacketSink sink(&writer);
+
+    Executor e(storage_, inference_, &conn->txn, &conn->settings);
+    e.ExecuteQuery(query, &sink);
 
-        Send(conn_fd, PreparePacket('Z', ""));
+    writer.Write('Z', "");
 
+    return !writer.Failed();
+}
+
+void Server::CloseConn(Conn* conn) {
+    epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, conn->fd, NULL);
+    close(conn->fd);
+
+    //an explicit transaction left open by the client is rolled back
+    if (conn->txn) {
+        conn->txn->Rollback();
+        delete conn->txn;
     }
 
-    close(conn_fd);
+    delete conn;
+    conn_count_--;
     std::cout << "connection closed\n";
 }
 
+//workers finish the query they are running, and connections still waiting in the queue are closed
+Server::~Server() {
+    {
+        std::lock_guard<std::mutex> lock(ready_mutex_);
+        stopping_ = true;
+    }
+    ready_cv_.notify_all();
+
+    for (std::thread& worker: workers_) {
+        worker.join();
+    }
+
+    while (!ready_conns_.empty()) {
+        CloseConn(ready_conns_.front());
+        ready_conns_.pop();
+    }
+
+    close(listener_fd_);
+    close(epoll_fd_);
+}
+
+void Server::WorkerLoop() {
+    while (true) {
+        Conn* conn;
+        {
+            std::unique_lock<std::mutex> lock(ready_mutex_);
+            ready_cv_.wait(lock, [this] { return stopping_ || !ready_conns_.empty(); });
+            if (stopping_)
+                return;
+            conn = ready_conns_.front();
+            ready_conns_.pop();
+        }
+
+        //a client can send its next query before reading the results of the last one, and 
+        //epoll won't report bytes that were already read into the buffer
+        std::string msg;
+        bool open = true;
+        while (open && TakeMessage(conn, &msg)) {
+            open = HandleQuery(conn, msg);
+        }
+
+        if (!open) {
+            CloseConn(conn);
+            continue;
+        }
+
+        ArmConn(conn);
+    }
+}
+
+//re-arms the socket so the reactor reports the next bytes sent on this connection
+void Server::ArmConn(Conn* conn) {
+    struct epoll_event ev;
+    ev.events = EPOLLIN | EPOLLONESHOT;
+    ev.data.ptr = conn;
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, conn->fd, &ev) == -1) {
+        CloseConn(conn);
+    }
+}
+
+//Reads what the client has sent so far without blocking, stopping once a complete message is buffered
+//so a client can't grow the buffer without bound.  Bytes left on the socket are reported again once
+//the connection is re-armed
+//Returns false if the client closed the connection, or sent a message with an invalid size
+bool Server::ReadConn(Conn* conn) {
+    char buf[CONN_READ_SIZE];
+    while (true) {
+        //checked as soon as the header arrives, before the rest of an oversized message is read
+        if (conn->recv_buf.size() >= sizeof(char) + sizeof(int)) {
+            int size;
+            memcpy(&size, conn->recv_buf.data() + sizeof(char), sizeof(int));
+            if (!ValidMessageSize(size))
+                return false;
+        }
+
+        if (CompleteMessageSize(conn->recv_buf) > 0)
+            return true;
+
+        ssize_t n = recv(conn->fd, buf, CONN_READ_SIZE, MSG_DONTWAIT);
+        if (n > 0) {
+            conn->recv_buf.append(buf, n);
+            continue;
+        }
+
+        if (n == 0)
+            return false;
+        if (errno == EINTR)
+            continue;
+        if (errno == EAGAIN || errno == EWOULDBLOCK)
+            return true;
+        return false;
+    }
+}
+
 int Server::GetListenerFD(const char* port) {
     struct addrinfo hints;
     memset(&hints, 0, sizeof(hints));
@@ -101,7 +241,12 @@ int Server::GetListenerFD(const char* port) {
         exit(1);
     }
 
-    if (listen(sockfd, BACKLOG) == -1) {
+    //accept is only called after epoll reports the listener as readable, and never blocks
+    if (fcntl(sockfd, F_SETFL, fcntl(sockfd, F_GETFL, 0) | O_NONBLOCK) == -1) {
+        exit(1);
+    }
+
+    if (listen(sockfd, backlog_) == -1) {
         exit(1);
     }
 
@@ -120,35 +265,95 @@ int Server::GetListenerFD(const char* port) {
 void Server::Listen(const char* port) {
     listener_fd_ = GetListenerFD(port);
 
+    epoll_fd_ = epoll_create1(0);
+    if (epoll_fd_ == -1) {
+        exit(1);
+    }
+
+    //listener is the only fd registered with a null data pointer
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.ptr = NULL;
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, listener_fd_, &ev) == -1) {
+        exit(1);
+    }
+
+    unsigned worker_count = std::thread::hardware_concurrency();
+    if (worker_count == 0)
+        worker_count = 4;
+
+    for (unsigned i = 0; i < worker_count; i++) {
+        workers_.emplace_back(&Server::WorkerLoop, this);
+    }
+
+    struct epoll_event events[MAX_EPOLL_EVENTS];
     while (true) {
-        socklen_t sin_size = sizeof(struct sockaddr_storage);
-        struct sockaddr_storage their_addr;
-        int conn_fd = accept(listener_fd_, (struct sockaddr*)&their_addr, &sin_size);
+        int n = epoll_wait(epoll_fd_, events, MAX_EPOLL_EVENTS, -1);
+        if (n == -1) {
+            if (errno == EINTR)
+                continue;
+            exit(1);
+        }
 
-        if (conn_fd == -1)
-            continue;
+        for (int i = 0; i < n; i++) {
+            if (events[i].data.ptr == NULL) {
+                AcceptConns();
+                continue;
+            }
 
-        ConnHandlerArgs* args = new ConnHandlerArgs();
-        args->storage = storage_;
-        args->inference = inference_;
-        args->conn_fd = conn_fd;
+            //the socket stays disarmed until the connection is closed, queued or re-armed here
+            Conn* conn = (Conn*)events[i].data.ptr;
+            if (!ReadConn(conn)) {
+                CloseConn(conn);
+                continue;
+            }
 
-        std::thread thrd(ConnHandler, args);
-        thrd.detach();
+            if (CompleteMessageSize(conn->recv_buf) == 0) {
+                ArmConn(conn);
+                continue;
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(ready_mutex_);
+                ready_conns_.push(conn);
+            }
+            ready_cv_.notify_one();
+        }
     } 
 }
 
-std::string Server::PreparePacket(char type, const std::string& msg) {
-    std::string buf;
+void Server::AcceptConns() {
+    while (true) {
+        socklen_t sin_size = sizeof(struct sockaddr_storage);
+        struct sockaddr_storage their_addr;
+        int conn_fd = accept(listener_fd_, (struct sockaddr*)&their_addr, &sin_size);
 
-    buf.append((char*)&type, sizeof(char));
+        //EAGAIN once all pending connections are accepted
+        if (conn_fd == -1)
+            return;
 
-    int size = sizeof(int) + msg.size();
-    buf.append((char*)&size, sizeof(int));
+        if (conn_count_ >= max_conns_) {
+            close(conn_fd);
+            continue;
+        }
 
-    buf += msg;
+        Conn* conn = new Conn();
+        conn->fd = conn_fd;
+        conn->txn = nullptr;
+        conn->settings = default_settings_;
+
+        struct epoll_event ev;
+        ev.events = EPOLLIN | EPOLLONESHOT;
+        ev.data.ptr = conn;
+        if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, conn_fd, &ev) == -1) {
+            close(conn_fd);
+            delete conn;
+            continue;
+        }
 
-    return buf;
+        conn_count_++;
+        std::cout << "handling connection\n";
+    }
 }
 
 }
@@ -1,40 +1,89 @@
 #pragma once
 
 #include <string>
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
 
 #include "status.h"
 #include "storage.h"
 #include "inference.h"
+#include "txn.h"
+#include "row_sink.h"
+#include "packet_writer.h"
+#include "settings.h"
 #include "./../include/tcp.h"
 
-#define BACKLOG 10
+#define MAX_EPOLL_EVENTS 64
+//bytes read from a client socket per recv call by the reactor
+#define CONN_READ_SIZE 4096
+//largest message a client may send, including the type and size header.  Connections sending
+//anything bigger are closed before the message is buffered
+#define MAX_MESSAGE_SIZE (256 << 20)
 
 namespace wsldb {
 
-struct ConnHandlerArgs {
-    Storage* storage;
-    Inference* inference;
-    int conn_fd;
+//state kept between queries on the same client connection
+struct Conn {
+    int fd;
+    Txn* txn;
+    Settings settings;
+    //bytes received but not yet handled, which may end with a partial message.  Only touched by
+    //the reactor while the socket is armed, and by the worker handling the connection otherwise
+    std::string recv_buf;
 };
 
+//Writes statement results to the client as wire protocol packets
+class PacketSink: public RowSink {
+public:
+    PacketSink(PacketWriter* writer): writer_(writer) {}
+    void BeginRows(const std::vector<Attribute>& attrs) override;
+    bool PushRow(const Row& row) override;
+    void EndStmt(Status s) override;
+private:
+    PacketWriter* writer_;
+};
+
+//A single reactor thread waits on the listener and all client sockets with epoll.  The reactor
+//reads whatever bytes are ready without blocking, and only queues a connection for the worker pool
+//once a complete query message has arrived, so a slow client never stalls a worker.  The socket is
+//only re-armed (EPOLLONESHOT) after a worker is done with it, so idle connections never hold a thread
 class Server: public TCPEndPoint {
 public:
-    Server(Storage* storage, Inference* inference): listener_fd_(-1), storage_(storage), inference_(inference) {}
+    Server(Storage* storage, Inference* inference, int backlog, int max_conns, Settings default_settings = Settings()): 
+        listener_fd_(-1), epoll_fd_(-1), storage_(storage), inference_(inference), 
+        backlog_(backlog), max_conns_(max_conns), default_settings_(default_settings), conn_count_(0) {}
 
-    virtual ~Server() {
-        close(listener_fd_);
-    }
+    virtual ~Server();
 
     void Listen(const char* port);
 private:
     int GetListenerFD(const char* port);
     static void SigChildHandler(int s);
-    static void ConnHandler(ConnHandlerArgs* args);
-    static std::string PreparePacket(char type, const std::string& msg);
+    void AcceptConns();
+    bool ReadConn(Conn* conn);
+    void ArmConn(Conn* conn);
+    void WorkerLoop();
+    bool HandleQuery(Conn* conn, const std::string& msg);
+    void CloseConn(Conn* conn);
 private:
     int listener_fd_;
+    int epoll_fd_;
     Storage* storage_;
     Inference* inference_;
+    int backlog_;
+    int max_conns_;
+    Settings default_settings_;
+    std::atomic<int> conn_count_;
+
+    std::vector<std::thread> workers_;
+    std::queue<Conn*> ready_conns_;
+    std::mutex ready_mutex_;
+    std::condition_variable ready_cv_;
+    bool stopping_ {false}; //guarded by ready_mutex_
 };
 
 }
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstddef>
+
+#include "spill.h"
+
+//default max rows passed to a model in a single PREDICT forward pass
+#define PREDICT_BATCH_SIZE 64
+
+namespace wsldb {
+
+//Per-connection values that can be changed with 'set <name> = <value>;'.  Each new connection
+//starts with a copy of the defaults the server was created with
+struct Settings {
+    //bytes of rows a single query may hold in sorts and aggregations before spilling to disk
+    size_t memory_budget {QUERY_MEMORY_BUDGET};
+    //max rows passed to a model in a single PREDICT forward pass
+    size_t predict_batch_size {PREDICT_BATCH_SIZE};
+};
+
+}
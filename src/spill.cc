@@ -0,0 +1,95 @@
+#include <cstring>
+
+#include "spill.h"
+
+namespace wsldb {
+
+size_t RowBytes(const Row& row) {
+    size_t bytes = sizeof(Row) + row.data_.capacity() * sizeof(Datum);
+    //text shared with other rows is charged to each of them, which overestimates but never lets a budget be exceeded
+    for (const Datum& d: row.data_) {
+        bytes += d.DataSize();
+    }
+    return bytes;
+}
+
+SpillFile::~SpillFile() {
+    Close();
+}
+
+void SpillFile::Close() {
+    if (file_) {
+        std::fclose(file_);
+        file_ = nullptr;
+    }
+}
+
+Status SpillFile::Open() {
+    file_ = std::tmpfile();
+    if (!file_)
+        return Status(false, "Execution Error: Could not create temporary file for spilling rows");
+
+    std::setvbuf(file_, nullptr, _IOFBF, SPILL_IO_BUFFER_SIZE);
+    return Status();
+}
+
+//record is the int size of the row, the int column count, and then the type and serialized value of each datum
+Status SpillFile::Write(const Row& row) {
+    buf_.clear();
+    int size = 0;
+    buf_.append((char*)&size, sizeof(int));
+    int count = row.data_.size();
+    buf_.append((char*)&count, sizeof(int));
+    for (const Datum& d: row.data_) {
+        char type = (char)d.Type();
+        buf_.append(&type, sizeof(char));
+        d.SerializeTo(&buf_);
+    }
+
+    size = buf_.size() - sizeof(int);
+    memcpy(&buf_[0], &size, sizeof(int));
+
+    if (std::fwrite(buf_.data(), 1, buf_.size(), file_) != buf_.size())
+        return Status(false, "Execution Error: Could not write spilled rows to temporary file");
+
+    row_count_++;
+    return Status();
+}
+
+Status SpillFile::Rewind() {
+    if (std::fflush(file_) != 0 || std::fseek(file_, 0, SEEK_SET) != 0)
+        return Status(false, "Execution Error: Could not read spilled rows from temporary file");
+    return Status();
+}
+
+Status SpillFile::Read(Row** row) {
+    *row = nullptr;
+
+    int size;
+    if (std::fread(&size, sizeof(int), 1, file_) != 1) {
+        if (std::feof(file_))
+            return Status();
+        return Status(false, "Execution Error: Could not read spilled rows from temporary file");
+    }
+
+    buf_.resize(size);
+    if (std::fread(&buf_[0], 1, size, file_) != (size_t)size)
+        return Status(false, "Execution Error: Could not read spilled rows from temporary file");
+
+    int off = 0;
+    int count = *((int*)(buf_.data() + off));
+    off += sizeof(int);
+
+    std::vector<Datum> data;
+    data.reserve(count);
+    for (int i = 0; i < count; i++) {
+        DatumType type = (DatumType)buf_.at(off);
+        off += sizeof(char);
+        data.push_back(Datum(buf_, &off, type));
+    }
+
+    *row = new Row(data);
+    return Status();
+}
+
+}
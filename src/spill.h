@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdio>
+#include <string>
+
+#include "row.h"
+#include "status.h"
+
+//default memory a single query may use for rows held by sorts, aggregations and hash joins before spilling
+#define QUERY_MEMORY_BUDGET (64 << 20)
+//number of partitions a hash aggregation (or hash join) splits its overflow rows into
+#define SPILL_PARTITION_COUNT 16
+//partitions that still don't fit are split again, using the next bits of the group key hash
+#define SPILL_MAX_DEPTH 8
+#define SPILL_IO_BUFFER_SIZE (1 << 20)
+
+namespace wsldb {
+
+//Approximate heap memory used by a row - used to charge rows against the query memory budget
+size_t RowBytes(const Row& row);
+
+//Temporary file of rows written once and then read back in order.  Each datum is stored with its
+//type, so rows of any shape can be spilled.  The file is created with tmpfile(), so it has no
+//name and is removed by the OS when closed, even if the server exits without cleaning up
+class SpillFile {
+public:
+    SpillFile() {}
+    virtual ~SpillFile();
+    Status Open();
+    Status Write(const Row& row);
+    //must be called after the last write and before the first read
+    Status Rewind();
+    //*row is set to nullptr once all rows have been read
+    Status Read(Row** row);
+    //releases the file once its rows are no longer needed
+    void Close();
+    inline size_t RowCount() const { return row_count_; }
+private:
+    std::FILE* file_ {nullptr};
+    std::string buf_;
+    size_t row_count_ {0};
+};
+
+}
@@ -1,9 +1,12 @@
 #pragma once
 
+#include <memory>
+
 #include "expr.h"
 #include "token.h"
 #include "table.h"
 #include "status.h"
+#include "copy.h"
 
 namespace wsldb {
 
@@ -19,7 +22,10 @@ enum class StmtType {
     DropTable,
     TxnControl,
     CreateModel,
-    DropModel
+    DropModel,
+    CopyFrom,
+    CopyTo,
+    Set
 };
 
 //Putting class Stmt here since we need it in Expr,
@@ -134,25 +140,25 @@ public:
 class DropTableStmt: public Stmt {
 public:
     DropTableStmt(Token target_relation, bool has_if_exists):
-        target_relation_(target_relation), has_if_exists_(has_if_exists), schema_(nullptr) {}
+        target_relation_(target_relation), has_if_exists_(has_if_exists) {}
     StmtType Type() const override {
         return StmtType::DropTable;
     }
 public:
     Token target_relation_;
     bool has_if_exists_;
-    Table* schema_;
+    std::shared_ptr<const Table> schema_;
 };
 
 class DescribeTableStmt: public Stmt {
 public:
-    DescribeTableStmt(Token target_relation): target_relation_(target_relation), schema_(nullptr) {}
+    DescribeTableStmt(Token target_relation): target_relation_(target_relation) {}
     StmtType Type() const override {
         return StmtType::DescribeTable;
     }
 public:
     Token target_relation_;
-    Table* schema_;
+    std::shared_ptr<const Table> schema_;
 };
 
 class TxnControlStmt: public Stmt {
@@ -187,4 +193,40 @@ public:
     bool has_if_exists_;
 };
 
+class CopyFromStmt: public Stmt {
+public:
+    CopyFromStmt(Token target, Token path, CopyFormat format): target_(target), path_(path), format_(format) {}
+    StmtType Type() const override {
+        return StmtType::CopyFrom;
+    }
+public:
+    Token target_;
+    Token path_;
+    CopyFormat format_;
+    std::shared_ptr<const Table> schema_;
+};
+
+class CopyToStmt: public Stmt {
+public:
+    CopyToStmt(SelectStmt* query, Token path, CopyFormat format): query_(query), path_(path), format_(format) {}
+    StmtType Type() const override {
+        return StmtType::CopyTo;
+    }
+public:
+    SelectStmt* query_;
+    Token path_;
+    CopyFormat format_;
+};
+
+class SetStmt: public Stmt {
+public:
+    SetStmt(Token name, Token value): name_(name), value_(value) {}
+    StmtType Type() const override {
+        return StmtType::Set;
+    }
+public:
+    Token name_;
+    Token value_;
+};
+
 }
@@ -1,17 +1,27 @@
 #include <iostream>
+#include <cstdio>
+
+#include "rocksdb/sst_file_writer.h"
 
 #include "storage.h"
 #include "index.h"
+#include "row_format.h"
 
 namespace wsldb {
 
 Storage::Storage(const std::string& path): path_(path) {
     LoadColFamDescriptors();
     OpenDB();
+    sequences_ = new SequenceManager(db_, GetColFamHandle(Sequences()));
+    UpgradeLegacyTables();
 }
 
 Storage::~Storage() {
-    for (rocksdb::ColumnFamilyHandle* handle: col_fam_handles_) {
+    delete sequences_;
+    for (const std::pair<const std::string, rocksdb::ColumnFamilyHandle*>& p: col_fam_handles_) {
+        dropped_col_fam_handles_.push_back(p.second);
+    }
+    for (rocksdb::ColumnFamilyHandle* handle: dropped_col_fam_handles_) {
         rocksdb::Status s = db_->DestroyColumnFamilyHandle(handle);
         if (!s.ok()) {
             std::cout << s.ToString() << std::endl;
@@ -26,12 +36,17 @@ void Storage::OpenDB() {
     options.create_if_missing = false;
     options.create_missing_column_families = true;
     rocksdb::TransactionDBOptions txndb_options;
-    rocksdb::Status s = rocksdb::TransactionDB::Open(options, txndb_options, path_, col_fam_descriptors_, &col_fam_handles_, &db_);
+    std::vector<rocksdb::ColumnFamilyHandle*> handles;
+    rocksdb::Status s = rocksdb::TransactionDB::Open(options, txndb_options, path_, col_fam_descriptors_, &handles, &db_);
 
     if (!s.ok()) {
         std::cout << "Rocksdb Error: " << s.ToString() << std::endl;
         std::exit(1);
     }
+
+    for (size_t i = 0; i < handles.size(); i++) {
+        col_fam_handles_.insert({col_fam_descriptors_.at(i).name, handles.at(i)});
+    }
 }
 
 void Storage::LoadColFamDescriptors() {
@@ -47,6 +62,7 @@ void Storage::LoadColFamDescriptors() {
 
     col_fam_descriptors_.emplace_back(Catalog(), rocksdb::ColumnFamilyOptions());
     col_fam_descriptors_.emplace_back(Models(), rocksdb::ColumnFamilyOptions());
+    col_fam_descriptors_.emplace_back(Sequences(), rocksdb::ColumnFamilyOptions());
 
     rocksdb::Iterator* it = db->NewIterator(rocksdb::ReadOptions());
     for (it->SeekToFirst(); it->Valid(); it->Next()) {
@@ -61,6 +77,69 @@ void Storage::LoadColFamDescriptors() {
     delete db;
 }
 
+//Index keys in databases written before catalog versioning were concatenated Datum::Serialize
+//fields, which don't sort in value order.  Those tables are rebuilt with the memcomparable
+//encoding when the database is opened, before any query can read them
+void Storage::UpgradeLegacyTables() {
+    std::vector<Table> legacy_tables;
+    rocksdb::Iterator* it = db_->NewIterator(rocksdb::ReadOptions(), GetColFamHandle(Catalog()));
+    for (it->SeekToFirst(); it->Valid(); it->Next()) {
+        Table table(it->key().ToString(), it->value().ToString());
+        if (table.legacy_rowid_counter_ >= 0)
+            legacy_tables.push_back(table);
+    }
+    delete it;
+
+    for (const Table& table: legacy_tables) {
+        Status s = UpgradeLegacyTable(table);
+        if (!s.Ok()) {
+            std::cout << "Upgrade of table '" << table.name_ << "' failed: " << s.Msg() << std::endl;
+            std::exit(1);
+        }
+    }
+}
+
+//Every index entry is rewritten from the primary index rows, and the catalog record is rewritten
+//in the current format in the same txn, so a crash never leaves a table half upgraded.  Row values
+//are left in the legacy row format, which is still read
+Status Storage::UpgradeLegacyTable(const Table& table) {
+    {
+        Status s = sequences_->AdvanceTo(table.name_, table.legacy_rowid_counter_);
+        if (!s.Ok())
+            return s;
+    }
+
+    Txn* txn = BeginTxn();
+
+    //all old keys are deleted before new keys are written, since an old key can equal a new one
+    const Index& primary_idx = table.idxs_.at(0);
+    std::vector<std::pair<std::vector<Datum>, std::string>> rows;
+    for (const Index& idx: table.idxs_) {
+        rocksdb::Iterator* it = db_->NewIterator(rocksdb::ReadOptions(), GetColFamHandle(idx.name_));
+        for (it->SeekToFirst(); it->Valid(); it->Next()) {
+            if (&idx == &primary_idx) {
+                std::string_view value(it->value().data(), it->value().size());
+                rows.emplace_back(DecodeRow(value, table.attrs_), std::string(value));
+            }
+            txn->Delete(idx.name_, it->key().ToString());
+        }
+        delete it;
+    }
+
+    for (const std::pair<std::vector<Datum>, std::string>& row: rows) {
+        std::string primary_key = primary_idx.GetKeyFromFields(row.first);
+        txn->Put(primary_idx.name_, primary_key, row.second);
+        for (size_t i = 1; i < table.idxs_.size(); i++) {
+            txn->Put(table.idxs_.at(i).name_, table.idxs_.at(i).GetKeyFromFields(row.first), primary_key);
+        }
+    }
+
+    txn->Put(Catalog(), table.name_, table.Serialize());
+    Status s = txn->Commit();
+    delete txn;
+    return s;
+}
+
 void Storage::CreateDatabase(const std::string& path) {
     rocksdb::Options options;
     options.create_if_missing = true;
@@ -82,10 +161,22 @@ std::string Storage::Models() {
     return "models";
 }
 
+std::string Storage::Sequences() {
+    return "sequences";
+}
+
 Status Storage::CreateTable(Table* table, Txn* txn) {
     //TODO: obtain exclusive lock on db_;
 
     txn->Put(Catalog(), table->name_, table->Serialize());
+    txn->AddCatalogWrite(table->name_);
+    InvalidateTable(table->name_);
+
+    {
+        Status s = sequences_->Reset(table->name_);
+        if (!s.Ok())
+            return s;
+    }
 
     for (const Index& idx: table->idxs_) {
         rocksdb::ColumnFamilyHandle* cf;
@@ -94,76 +185,189 @@ Status Storage::CreateTable(Table* table, Txn* txn) {
             std::cout << s.ToString() << std::endl;
             std::exit(1);
         }
-        col_fam_handles_.push_back(cf);
-        col_fam_descriptors_.emplace_back(idx.name_, rocksdb::ColumnFamilyOptions());
+        std::unique_lock<std::shared_mutex> lock(col_fam_mutex_);
+        col_fam_handles_.insert({idx.name_, cf});
     }
 
     //TODO: release exclusive lock on db_;
     return Status();
 }
 
-Status Storage::DropTable(Table* table, Txn* txn) {
+Status Storage::DropTable(const Table* table, Txn* txn) {
     //TODO: obtain exclusive lock on db_;
 
 
     txn->Delete(Catalog(), table->name_);
+    txn->AddCatalogWrite(table->name_);
+    InvalidateTable(table->name_);
 
     for (const Index& idx: table->idxs_) {
-        int i = GetColFamIdx(idx.name_);
+        rocksdb::ColumnFamilyHandle* cf;
+        {
+            std::unique_lock<std::shared_mutex> lock(col_fam_mutex_);
+            auto it = col_fam_handles_.find(idx.name_);
+            if (it == col_fam_handles_.end()) {
+                std::cout << "DropTable - Invalid column family name: " + idx.name_ + "\n";
+                std::exit(1);
+            }
+            cf = it->second;
+            col_fam_handles_.erase(it);
+            dropped_col_fam_handles_.push_back(cf);
+        }
 
-        rocksdb::Status s = db_->DropColumnFamily(col_fam_handles_[i]);
+        rocksdb::Status s = db_->DropColumnFamily(cf);
         if (!s.ok()) {
             std::cout << s.ToString() << std::endl;
             std::exit(1);
         }
+    }
 
-        s = db_->DestroyColumnFamilyHandle(col_fam_handles_[i]);
-        if (!s.ok()) {
-            std::cout << s.ToString() << std::endl;
-            std::exit(1);
+    //TODO: release exclusive lock on db_;
+    return Status();
+}
+
+Txn* Storage::BeginTxn() {
+    rocksdb::WriteOptions options;
+    //snapshot is taken when the txn begins so all reads in the txn are repeatable
+    rocksdb::TransactionOptions txn_options;
+    txn_options.set_snapshot = true;
+    //the version is read before the snapshot is taken, so the snapshot includes every catalog change up to it
+    uint64_t catalog_version;
+    {
+        std::lock_guard<std::mutex> lock(catalog_mutex_);
+        catalog_version = catalog_version_;
+    }
+    rocksdb::Transaction* rocksdb_txn = db_->BeginTransaction(options, txn_options);
+    return new Txn(rocksdb_txn, this, catalog_version);
+}
+
+Status Storage::GetTable(const std::string& table_name, Txn* txn, std::shared_ptr<const Table>* table) {
+    //a txn with uncommitted DDL reads its own catalog writes, and those schemas are never cached
+    if (txn->HasCatalogWrites()) {
+        std::string serialized_schema;
+        Status s = txn->Get(Catalog(), table_name, &serialized_schema);
+        if (!s.Ok())
+            return s;
+
+        return LoadTable(table_name, serialized_schema, table);
+    }
+
+    //the cache holds the latest committed schemas, so only txns whose snapshot was taken
+    //after the last catalog change can use it.  Older txns read the catalog from their snapshot
+    {
+        std::lock_guard<std::mutex> lock(catalog_mutex_);
+        if (txn->CatalogVersion() == catalog_version_) {
+            auto it = tables_.find(table_name);
+            if (it != tables_.end()) {
+                *table = it->second;
+                return Status();
+            }
         }
+    }
 
-        col_fam_handles_.erase(col_fam_handles_.begin() + i);
-        col_fam_descriptors_.erase(col_fam_descriptors_.begin() + i);
+    std::string serialized_schema;
+    Status s = txn->Get(Catalog(), table_name, &serialized_schema);
+    if (!s.Ok())
+        return s;
+
+    std::shared_ptr<const Table> loaded;
+    Status load_s = LoadTable(table_name, serialized_schema, &loaded);
+    if (!load_s.Ok())
+        return load_s;
+
+    {
+        std::lock_guard<std::mutex> lock(catalog_mutex_);
+        //a CREATE/DROP TABLE may have invalidated the cache since the snapshot was taken
+        if (txn->CatalogVersion() == catalog_version_) {
+            auto it = tables_.insert({table_name, loaded}).first;
+            loaded = it->second;
+        }
     }
 
+    *table = loaded;
+    return Status();
+}
 
+//tables from legacy catalog records kept their rowid counter in the record, so their sequence
+//is moved past it before any rows can be inserted
+Status Storage::LoadTable(const std::string& table_name, const std::string& serialized_schema, std::shared_ptr<const Table>* table) {
+    std::shared_ptr<const Table> loaded = std::make_shared<const Table>(table_name, serialized_schema);
+    if (loaded->legacy_rowid_counter_ >= 0) {
+        Status s = sequences_->AdvanceTo(table_name, loaded->legacy_rowid_counter_);
+        if (!s.Ok())
+            return s;
+    }
 
-    //TODO: release exclusive lock on db_;
+    *table = loaded;
     return Status();
 }
 
-Txn* Storage::BeginTxn() {
-    rocksdb::WriteOptions options;
-    rocksdb::Transaction* rocksdb_txn = db_->BeginTransaction(options);
-    return new Txn(rocksdb_txn, &col_fam_descriptors_, &col_fam_handles_);
+void Storage::InvalidateTable(const std::string& table_name) {
+    std::lock_guard<std::mutex> lock(catalog_mutex_);
+    catalog_version_++;
+    tables_.erase(table_name);
 }
 
-Iterator* Storage::NewIterator(const std::string& col_fam) {
-    return new Iterator(db_->NewIterator(rocksdb::ReadOptions(), GetColFamHandle(col_fam)));
+Status Storage::NextRowId(const std::string& table_name, int64_t* rowid) {
+    return sequences_->NextValue(table_name, rowid);
 }
 
-int Storage::GetColFamIdx(const std::string& col_fam) {
-    for (size_t i = 0; i < col_fam_descriptors_.size(); i++) {
-        if (col_fam.compare(col_fam_descriptors_.at(i).name) == 0) {
-            return i;
+Status Storage::IngestSorted(const std::vector<std::string>& col_fams, 
+                             const std::vector<std::vector<std::pair<std::string, std::string>>>& sorted_kvs) {
+    std::vector<rocksdb::IngestExternalFileArg> args;
+    std::vector<std::string> sst_paths;
+    Status result;
+
+    for (size_t i = 0; i < col_fams.size(); i++) {
+        //sst files must contain at least one key
+        if (sorted_kvs.at(i).empty())
+            continue;
+
+        rocksdb::ColumnFamilyHandle* cf = GetColFamHandle(col_fams.at(i));
+        std::string sst_path = path_ + "/ingest_" + std::to_string(sst_file_counter_++) + ".sst";
+        sst_paths.push_back(sst_path);
+
+        rocksdb::SstFileWriter writer(rocksdb::EnvOptions(), rocksdb::Options(), cf);
+        rocksdb::Status s = writer.Open(sst_path);
+        for (size_t j = 0; s.ok() && j < sorted_kvs.at(i).size(); j++) {
+            s = writer.Put(sorted_kvs.at(i).at(j).first, sorted_kvs.at(i).at(j).second);
         }
+        if (s.ok())
+            s = writer.Finish();
+
+        if (!s.ok()) {
+            result = Status(false, "Execution Error: Rocksdb SstFileWriter failed: " + s.ToString());
+            break;
+        }
+
+        rocksdb::IngestExternalFileArg arg;
+        arg.column_family = cf;
+        arg.external_files.push_back(sst_path);
+        arg.options.move_files = true;
+        args.push_back(arg);
     }
 
-    std::cout << "GetColFamIdx - Invalid column family name: " + col_fam + "\n";
-    std::exit(1);
+    if (result.Ok() && !args.empty()) {
+        rocksdb::Status s = db_->IngestExternalFiles(args);
+        if (!s.ok())
+            result = Status(false, "Execution Error: Rocksdb IngestExternalFiles failed: " + s.ToString());
+    }
+
+    //ingested files are hard linked into the db, so the original paths can always be removed
+    for (const std::string& sst_path: sst_paths) {
+        std::remove(sst_path.c_str());
+    }
+
+    return result;
 }
 
-//TODO: same function exists in Txn class - Txn class should just get a function pointer to this function
 rocksdb::ColumnFamilyHandle* Storage::GetColFamHandle(const std::string& col_fam) {
-    for (size_t i = 0; i < col_fam_descriptors_.size(); i++) {
-        if (col_fam.compare(col_fam_descriptors_.at(i).name) == 0) {
-            return col_fam_handles_.at(i);
-        }
-    }
+    std::shared_lock<std::shared_mutex> lock(col_fam_mutex_);
+    auto it = col_fam_handles_.find(col_fam);
+    if (it != col_fam_handles_.end())
+        return it->second;
 
     std::cout << "GetColFamHandle - Invalid column family name: " + col_fam + "\n";
     std::exit(1);
 }
-
 }
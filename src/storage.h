@@ -3,6 +3,11 @@
 #include <string>
 #include <vector>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+#include <atomic>
 
 #include "rocksdb/db.h"
 #include "rocksdb/utilities/transaction_db.h"
@@ -10,6 +15,7 @@
 #include "table.h"
 #include "iterator.h"
 #include "txn.h"
+#include "sequence.h"
 
 namespace wsldb {
 
@@ -23,17 +29,37 @@ public:
     static void DropDatabase(const std::string& path);
     static std::string Catalog();
     static std::string Models();
+    static std::string Sequences();
     Status CreateTable(Table* schema, Txn* txn);
-    Status DropTable(Table* schema, Txn* txn);
+    Status DropTable(const Table* schema, Txn* txn);
+    //schemas are cached and shared by all connections, so the returned table must not be modified
+    Status GetTable(const std::string& table_name, Txn* txn, std::shared_ptr<const Table>* table);
+    void InvalidateTable(const std::string& table_name);
     Txn* BeginTxn();
-    Iterator* NewIterator(const std::string& col_fam);
-    int GetColFamIdx(const std::string& col_fam);
+    Status NextRowId(const std::string& table_name, int64_t* rowid);
+    //writes each column family's sorted key/values to an sst file and ingests all files atomically
+    //ingestion bypasses transactions, so the data is visible immediately and is never rolled back
+    Status IngestSorted(const std::vector<std::string>& col_fams, 
+                        const std::vector<std::vector<std::pair<std::string, std::string>>>& sorted_kvs);
     rocksdb::ColumnFamilyHandle* GetColFamHandle(const std::string& col_fam);
+private:
+    void UpgradeLegacyTables();
+    Status UpgradeLegacyTable(const Table& table);
+    Status LoadTable(const std::string& table_name, const std::string& serialized_schema, std::shared_ptr<const Table>* table);
 private:
     std::string path_;
     rocksdb::TransactionDB* db_;
-    std::vector<rocksdb::ColumnFamilyDescriptor> col_fam_descriptors_;
-    std::vector<rocksdb::ColumnFamilyHandle*> col_fam_handles_;
+    std::vector<rocksdb::ColumnFamilyDescriptor> col_fam_descriptors_; //only used to open the db
+    std::shared_mutex col_fam_mutex_;
+    std::unordered_map<std::string, rocksdb::ColumnFamilyHandle*> col_fam_handles_;
+    //handles of dropped column families are kept until the db closes since other txns
+    //(or their iterators) may still be holding them
+    std::vector<rocksdb::ColumnFamilyHandle*> dropped_col_fam_handles_;
+    SequenceManager* sequences_;
+    std::mutex catalog_mutex_;
+    uint64_t catalog_version_ {0}; //incremented on every invalidation
+    std::unordered_map<std::string, std::shared_ptr<const Table>> tables_;
+    std::atomic<uint64_t> sst_file_counter_ {0};
 };
 
 
@@ -9,7 +9,6 @@ Table::Table(std::string name,
                std::vector<std::vector<Token>> uniques) {
 
     name_ = name;
-    rowid_counter_ = 0;
     not_null_constraints_ = not_null_constraints;
 
     //NOTE: index creation requires attrs_ to be filled in beforehand
@@ -33,8 +32,10 @@ Table::Table(std::string name, const std::string& buf) {
 
     int off = 0; 
 
-    rowid_counter_ = *((int64_t*)(buf.data() + off));
+    int64_t header = *((int64_t*)(buf.data() + off));
     off += sizeof(int64_t);
+    if (header >= 0)
+        legacy_rowid_counter_ = header;
 
     //attributes
     int count = *((int*)(buf.data() + off));
@@ -67,7 +68,8 @@ Table::Table(std::string name, const std::string& buf) {
 std::string Table::Serialize() const {
     std::string buf;
 
-    buf.append((char*)&rowid_counter_, sizeof(int64_t));
+    int64_t header = -TABLE_FORMAT_V1;
+    buf.append((char*)&header, sizeof(int64_t));
 
     //attributes
     int count = attrs_.size();
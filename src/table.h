@@ -9,6 +9,10 @@
 #include "index.h"
 #include "attribute.h"
 
+//Catalog records start with an int64.  Records written before versioning start with the table's
+//rowid counter, which is never negative, so versioned records store the negated version instead
+#define TABLE_FORMAT_V1 1
+
 namespace wsldb {
 
 class Table {
@@ -26,17 +30,13 @@ public:
     std::string IdxName(const std::string& prefix, const std::vector<int>& idxs) const;
     int GetAttrIdx(const std::string& name) const;
 
-    inline int64_t NextRowId() {
-        return rowid_counter_++;
-    }
-
-
 public:
     std::string name_;
-    int64_t rowid_counter_;
     std::vector<Attribute> attrs_;
     std::vector<bool> not_null_constraints_;
     std::vector<Index> idxs_;
+    //next _rowid stored in a legacy catalog record, or -1.  Used to seed the table's sequence on upgrade
+    int64_t legacy_rowid_counter_ {-1};
 };
 
 
@@ -153,6 +153,12 @@ std::string TokenTypeToString(TokenType type) {
             return "Having";
         case TokenType::Nulls:
             return "Nulls";
+        case TokenType::Copy:
+            return "Copy";
+        case TokenType::Csv:
+            return "Csv";
+        case TokenType::Binary:
+            return "Binary";
         default:
             return "Unrecognized token";
     }
@@ -69,6 +69,9 @@ enum class TokenType {
     Like,
     Similar,
     To,
+    Copy,
+    Csv,
+    Binary,
 
     /* user-defined identifier */
     Identifier,
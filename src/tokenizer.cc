@@ -33,7 +33,8 @@ static std::vector<Keyword> keywords[] = {
         {"avg", TokenType::Avg},
         {"sum", TokenType::Sum},
         {"max", TokenType::Max},
-        {"min", TokenType::Min}
+        {"min", TokenType::Min},
+        {"csv", TokenType::Csv}
     },
     {   //4
         {"text", TokenType::Text},
@@ -49,7 +50,8 @@ static std::vector<Keyword> keywords[] = {
         {"full", TokenType::Full},
         {"int8", TokenType::Int8},
         {"cast", TokenType::Cast},
-        {"like", TokenType::Like}
+        {"like", TokenType::Like},
+        {"copy", TokenType::Copy}
     },
     {   //5
         {"table", TokenType::Table},
@@ -78,7 +80,8 @@ static std::vector<Keyword> keywords[] = {
         {"exists", TokenType::Exists},
         {"unique", TokenType::Unique},
         {"commit", TokenType::Commit},
-        {"having", TokenType::Having}
+        {"having", TokenType::Having},
+        {"binary", TokenType::Binary}
     },
     {   //7
         {"primary", TokenType::Primary},
@@ -235,7 +238,7 @@ Status Tokenizer::MakeString(Token* t) {
     Tokenizer::ReplaceAll(s, "\'\'", "\'");
 
     //if first two characters are \x, must be a bytea literal
-    if (s.at(0) == '\\' && s.size() > 1 && s.at(1) == 'x') {
+    if (s.size() > 1 && s.at(0) == '\\' && s.at(1) == 'x') {
         type = TokenType::ByteaLiteral;
     }
 
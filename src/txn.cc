@@ -1,15 +1,20 @@
+#include <algorithm>
+
 #include "txn.h"
+#include "storage.h"
+#include "inference.h"
 
 namespace wsldb {
-Txn::Txn(rocksdb::Transaction* rocksdb_txn, 
-       std::vector<rocksdb::ColumnFamilyDescriptor>* col_fam_descriptors, 
-       std::vector<rocksdb::ColumnFamilyHandle*>* col_fam_handles): 
+Txn::Txn(rocksdb::Transaction* rocksdb_txn, Storage* storage, uint64_t catalog_version): 
             rocksdb_txn_(rocksdb_txn),
-            col_fam_descriptors_(col_fam_descriptors),
-            col_fam_handles_(col_fam_handles),
+            storage_(storage),
+            catalog_version_(catalog_version),
             has_aborted_(false) {}
 
-Txn::~Txn() { delete rocksdb_txn_; }
+Txn::~Txn() { 
+    DeleteIterators();
+    delete rocksdb_txn_; 
+}
 
 Status Txn::Put(const std::string& col_fam, const std::string& key, const std::string& value) {
     rocksdb::Status s = rocksdb_txn_->Put(GetColFamHandle(col_fam), key, value);
@@ -20,12 +25,62 @@ Status Txn::Put(const std::string& col_fam, const std::string& key, const std::s
 
 Status Txn::Get(const std::string& col_fam, const std::string& key, std::string* value) {
     rocksdb::ReadOptions read_options;
+    read_options.snapshot = rocksdb_txn_->GetSnapshot();
     rocksdb::Status s = rocksdb_txn_->Get(read_options, GetColFamHandle(col_fam), key, value);
     if (s.ok())
         return Status();
     return Status(false, "Execution Error: Rocksdb transaction Get failed");
 }
 
+Status Txn::GetLatest(const std::string& col_fam, const std::string& key, std::string* value) {
+    rocksdb::Status s = rocksdb_txn_->Get(rocksdb::ReadOptions(), GetColFamHandle(col_fam), key, value);
+    if (s.ok())
+        return Status();
+    return Status(false, "Execution Error: Rocksdb transaction Get failed");
+}
+
+Status Txn::MultiGet(const std::string& col_fam, const std::vector<std::string>& keys, std::vector<bool>* found) {
+    rocksdb::ReadOptions read_options;
+    read_options.snapshot = rocksdb_txn_->GetSnapshot();
+
+    std::vector<rocksdb::ColumnFamilyHandle*> handles(keys.size(), GetColFamHandle(col_fam));
+    std::vector<rocksdb::Slice> key_slices;
+    for (const std::string& key: keys) {
+        key_slices.emplace_back(key);
+    }
+
+    std::vector<std::string> values;
+    std::vector<rocksdb::Status> statuses = rocksdb_txn_->MultiGet(read_options, handles, key_slices, &values);
+
+    found->clear();
+    for (const rocksdb::Status& s: statuses) {
+        if (!s.ok() && !s.IsNotFound())
+            return Status(false, "Execution Error: Rocksdb transaction MultiGet failed");
+        found->push_back(s.ok());
+    }
+
+    return Status();
+}
+
+Status Txn::MultiGetForUpdate(const std::string& col_fam, const std::vector<std::string>& keys, std::vector<bool>* found) {
+    rocksdb::ColumnFamilyHandle* handle = GetColFamHandle(col_fam);
+    rocksdb::ReadOptions read_options;
+
+    found->clear();
+    found->reserve(keys.size());
+    std::string value;
+    for (const std::string& key: keys) {
+        rocksdb::Status s = rocksdb_txn_->GetForUpdate(read_options, handle, key, &value);
+        if (s.IsBusy() || s.IsTimedOut())
+            return Status(false, "Execution Error: Could not lock key held by a concurrent transaction");
+        if (!s.ok() && !s.IsNotFound())
+            return Status(false, "Execution Error: Rocksdb transaction GetForUpdate failed");
+        found->push_back(s.ok());
+    }
+
+    return Status();
+}
+
 Status Txn::Delete(const std::string& col_fam, const std::string& key) {
     rocksdb::Status s = rocksdb_txn_->Delete(GetColFamHandle(col_fam), key);
     if (s.ok())
@@ -33,33 +88,76 @@ Status Txn::Delete(const std::string& col_fam, const std::string& key) {
     return Status(false, "Execution Error: Rocksdb transaction Delete failed");
 }
 
-rocksdb::ColumnFamilyHandle* Txn::GetColFamHandle(const std::string& col_fam) {
-    for (size_t i = 0; i < col_fam_descriptors_->size(); i++) {
-        if (col_fam.compare(col_fam_descriptors_->at(i).name) == 0) {
-            return col_fam_handles_->at(i);
-        }
+Iterator* Txn::NewIterator(const std::string& col_fam) {
+    rocksdb::ReadOptions read_options;
+    read_options.snapshot = rocksdb_txn_->GetSnapshot();
+    Iterator* it = new Iterator(rocksdb_txn_->GetIterator(read_options, GetColFamHandle(col_fam)));
+    iterators_.push_back(it);
+    return it;
+}
+
+void Txn::DeleteIterator(Iterator* it) {
+    iterators_.erase(std::find(iterators_.begin(), iterators_.end(), it));
+    delete it;
+}
+
+//rocksdb iterators from a transaction must not be used after the transaction ends
+void Txn::DeleteIterators() {
+    for (Iterator* it: iterators_) {
+        delete it;
     }
+    iterators_.clear();
+}
 
-    std::cout << "Txn::GetColFamHandle - Invalid column family name: " + col_fam + "\n";
-    std::exit(1);
+rocksdb::ColumnFamilyHandle* Txn::GetColFamHandle(const std::string& col_fam) {
+    return storage_->GetColFamHandle(col_fam);
 }
 
 Status Txn::Commit() {
+    DeleteIterators();
     rocksdb::Status s = rocksdb_txn_->Commit();
     if (!s.ok()) {
         std::cout << "Rocksdb Commit Error: " << s.ToString() << std::endl;
         std::exit(1);
     }
+    InvalidateCatalogWrites();
+    InvalidateModelWrites();
 
     return Status();
 }
 
 Status Txn::Rollback() {
+    DeleteIterators();
     rocksdb::Status s = rocksdb_txn_->Rollback();
     if (!s.ok()) {
         std::cout << "Rocksdb Rollback Error: " << s.ToString() << std::endl;
         std::exit(1);
     }
+    InvalidateCatalogWrites();
+    InvalidateModelWrites();
     return Status();
 }
+
+void Txn::AddCatalogWrite(const std::string& table_name) {
+    catalog_writes_.push_back(table_name);
+}
+
+void Txn::InvalidateCatalogWrites() {
+    for (const std::string& table_name: catalog_writes_) {
+        storage_->InvalidateTable(table_name);
+    }
+    catalog_writes_.clear();
+}
+
+void Txn::AddModelWrite(Inference* inference, const std::string& model_name) {
+    inference_ = inference;
+    model_writes_.push_back(model_name);
+}
+
+void Txn::InvalidateModelWrites() {
+    for (const std::string& model_name: model_writes_) {
+        inference_->InvalidateModel(model_name);
+    }
+    model_writes_.clear();
+}
 }
@@ -7,30 +7,59 @@
 #include "rocksdb/db.h"
 #include "rocksdb/utilities/transaction_db.h"
 #include "status.h"
+#include "iterator.h"
 
 namespace wsldb {
 
+class Storage;
+class Inference;
+
 class Txn {
 public:
-    Txn(rocksdb::Transaction* rocksdb_txn, 
-           std::vector<rocksdb::ColumnFamilyDescriptor>* col_fam_descriptors, 
-           std::vector<rocksdb::ColumnFamilyHandle*>* col_fam_handles);
+    Txn(rocksdb::Transaction* rocksdb_txn, Storage* storage, uint64_t catalog_version);
     virtual ~Txn();
     Status Put(const std::string& col_fam, const std::string& key, const std::string& value);
     Status Get(const std::string& col_fam, const std::string& key, std::string* value);
+    //reads the latest committed value (merged with this txn's own writes) rather than the txn snapshot
+    Status GetLatest(const std::string& col_fam, const std::string& key, std::string* value);
+    //looks up all keys in a single rocksdb call - found->at(i) is set if keys.at(i) exists
+    Status MultiGet(const std::string& col_fam, const std::vector<std::string>& keys, std::vector<bool>* found);
+    //like MultiGet, but reads the latest committed state and locks each key until the txn ends, so no other
+    //txn can write the keys in the meantime.  Fails if a key was written by another txn after this txn's snapshot
+    Status MultiGetForUpdate(const std::string& col_fam, const std::vector<std::string>& keys, std::vector<bool>* found);
     //TODO: Implement GetForUpdate (and use in Executor) for repeat-read/snapshot isolation level
     Status Delete(const std::string& col_fam, const std::string& key);
-    //TODO: Storage has the exact same function, Txn should get a function pointer to that function
-    //rather than having its own version
+    //iterators read from the txn snapshot merged with the txn's own writes
+    //they are owned by the txn and deleted when it ends, or earlier with DeleteIterator
+    Iterator* NewIterator(const std::string& col_fam);
+    void DeleteIterator(Iterator* it);
     rocksdb::ColumnFamilyHandle* GetColFamHandle(const std::string& col_fam);
     Status Commit();
     Status Rollback();
+    //tables created or dropped in this txn are evicted from the catalog cache again when the
+    //txn ends, since other connections may have cached the old schema in the meantime
+    void AddCatalogWrite(const std::string& table_name);
+    bool HasCatalogWrites() const { return !catalog_writes_.empty(); }
+    //catalog version when the snapshot was taken - schemas cached since a later version may be newer than the snapshot
+    uint64_t CatalogVersion() const { return catalog_version_; }
+    //same as catalog writes, but for models created or dropped in this txn
+    void AddModelWrite(Inference* inference, const std::string& model_name);
+    bool HasModelWrites() const { return !model_writes_.empty(); }
+private:
+    void DeleteIterators();
+    void InvalidateCatalogWrites();
+    void InvalidateModelWrites();
 private:
     rocksdb::Transaction* rocksdb_txn_;
-    std::vector<rocksdb::ColumnFamilyDescriptor>* col_fam_descriptors_;
-    std::vector<rocksdb::ColumnFamilyHandle*>* col_fam_handles_;
+    Storage* storage_;
+    std::vector<std::string> catalog_writes_;
+    uint64_t catalog_version_;
+    Inference* inference_ {nullptr};
+    std::vector<std::string> model_writes_;
+    std::vector<Iterator*> iterators_;
 public:
     bool has_aborted_;
+    bool is_explicit_ {false}; //started with BEGIN rather than automatically for a single statement
 };
 
 }
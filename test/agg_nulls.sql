@@ -0,0 +1,12 @@
+create table planets (id int8, name text, moons int8, rings bool, primary key (id));
+insert into planets (id, name, moons, rings) values (1, 'Earth', 1, false), (2, 'Mars', null, false), (3, 'Saturn', 50, true), (4, 'Uranus', null, true), (5, 'Pluto', null, null);
+
+select count(moons), sum(moons), avg(moons), min(moons), max(moons) from planets;
+select count(moons), sum(moons), min(moons), max(moons) from planets where moons is null;
+select rings, count(moons), sum(moons), max(moons) from planets group by rings;
+
+delete from planets where true;
+select count(id), sum(moons), avg(moons), min(name), max(name) from planets;
+select rings, count(id) from planets group by rings;
+
+drop table planets;
@@ -0,0 +1,12 @@
+create table planets (id int8, name text, primary key (id));
+
+copy planets from '/nonexistent/planets.csv';
+copy moons from '/nonexistent/moons.csv';
+
+begin;
+copy planets from '/nonexistent/planets.csv';
+rollback;
+
+select id, name from planets;
+
+drop table planets;
@@ -0,0 +1,26 @@
+create table moons (id int8, name text, planet text, radius float4, primary key (id), unique (name) nulls not distinct);
+
+insert into moons (id, name, planet, radius) values (1, 'Moon', 'Earth', 1737.4), (2, 'Phobos', 'Mars', 11.3), (3, 'Deimos', 'Mars', 6.2), (4, 'Io', 'Jupiter', 1821.6), (5, 'Europa', 'Jupiter', 1560.8), (6, 'Titan', null, 2574.7);
+
+copy (select id, name, planet, radius from moons) to '/tmp/wsldb_copy_from_load.csv';
+copy (select id, name, planet, radius from moons) to '/tmp/wsldb_copy_from_load.bin' binary;
+copy (select 7, name, planet, radius from moons) to '/tmp/wsldb_copy_from_load_dup_pk.csv';
+copy (select id, planet, name, radius from moons where planet = 'Mars') to '/tmp/wsldb_copy_from_load_dup_name.csv';
+
+create table csv_moons (id int8, name text, planet text, radius float4, primary key (id), unique (name) nulls not distinct);
+copy csv_moons from '/tmp/wsldb_copy_from_load.csv' csv;
+select id, name, planet, radius from csv_moons;
+
+create table bin_moons (id int8, name text, planet text, radius float4, primary key (id), unique (name) nulls not distinct);
+copy bin_moons from '/tmp/wsldb_copy_from_load.bin' binary;
+select id, name, planet, radius from bin_moons where id > 3;
+
+create table dup_moons (id int8, name text, planet text, radius float4, primary key (id), unique (name) nulls not distinct);
+copy dup_moons from '/tmp/wsldb_copy_from_load_dup_pk.csv' csv;
+copy dup_moons from '/tmp/wsldb_copy_from_load_dup_name.csv' csv;
+select id, name from dup_moons;
+
+drop table moons;
+drop table csv_moons;
+drop table bin_moons;
+drop table dup_moons;
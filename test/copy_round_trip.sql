@@ -0,0 +1,19 @@
+create table planets (id int8, name text, moons int8, primary key (id), unique (name) nulls distinct);
+
+insert into planets (id, name, moons) values (1, 'Mercury', 0), (2, 'Venus', 0), (3, 'Earth', 1), (4, 'Mars', 2), (5, 'Pluto', null), (6, '', 3);
+
+copy (select id, name, moons from planets) to '/tmp/wsldb_copy_round_trip.csv';
+copy (select id, name, moons from planets) to '/tmp/wsldb_copy_round_trip.bin' binary;
+
+create table csv_planets (id int8, name text, moons int8, primary key (id), unique (name) nulls distinct);
+copy csv_planets from '/tmp/wsldb_copy_round_trip.csv' csv;
+select id, name, moons, moons is null, name = '' from csv_planets;
+
+create table bin_planets (id int8, name text, moons int8, primary key (id));
+copy bin_planets from '/tmp/wsldb_copy_round_trip.bin' binary;
+copy bin_planets from '/tmp/wsldb_copy_round_trip.bin' binary;
+select id, name, moons, moons is null, name = '' from bin_planets where id > 3;
+
+drop table planets;
+drop table csv_planets;
+drop table bin_planets;
@@ -0,0 +1,10 @@
+create table readings (id int8, qty int8, level float4, ok bool, label text, primary key (id));
+insert into readings (id, qty, level, ok, label) values (1, 10, 2.5, true, 'low'), (2, 7, null, false, 'high'), (3, null, 1.0, true, 'mid');
+
+select id, qty / 2, qty * level, -qty, not ok from readings;
+select id from readings where qty > 5 and ok = true;
+select id from readings where level is null or label = 'mid';
+select id, cast(qty as float4) / 4 from readings where qty is not null;
+select qty / 0 from readings where id = 1;
+
+drop table readings;
@@ -0,0 +1,18 @@
+create table a (id int8, k int8, v text, primary key (id));
+insert into a (id, k, v) values (1, 1, 'a1'), (2, 2, 'a2'), (3, 2, 'a3'), (5, 5, 'a5');
+insert into a (id, v) values (4, 'a4');
+
+create table b (id int8, k int8, v text, primary key (id));
+insert into b (id, k, v) values (1, 2, 'b1'), (3, 1, 'b3');
+insert into b (id, v) values (2, 'b2');
+
+select a.v, b.v from a inner join b on a.k = b.k;
+select '----';
+select a.v, b.v from a full join b on a.k = b.k;
+select '----';
+select a.v, b.v from a left join b on a.k = b.k and a.id > 2;
+select '----';
+select a.v, b.v from a cross join b where b.k = a.k;
+
+drop table a;
+drop table b;
@@ -0,0 +1,19 @@
+create table a (id int8, k int8, v text, primary key (id));
+insert into a (id, k, v) values (1, 1, 'a1'), (2, 2, 'a2'), (3, 2, 'a3'), (5, 5, 'a5'), (6, 7, 'a6'), (7, 8, 'a7'), (8, 9, 'a8');
+insert into a (id, v) values (4, 'a4');
+
+create table b (id int8, k int8, v text, primary key (id));
+insert into b (id, k, v) values (1, 2, 'b1'), (3, 1, 'b3'), (4, 7, 'b4'), (5, 7, 'b5'), (6, 10, 'b6');
+insert into b (id, v) values (2, 'b2');
+
+set memory_budget = 1;
+select a.v, b.v from a inner join b on a.k = b.k order by a.v asc, b.v asc;
+select '----';
+select a.v, b.v from a full join b on a.k = b.k order by a.v asc, b.v asc;
+select '----';
+select a.v, b.v from a left join b on a.k = b.k and a.id > 2 order by a.v asc, b.v asc;
+select '----';
+select a.v, b.v from a right join b on a.k = b.k order by b.v asc, a.v asc;
+
+drop table a;
+drop table b;
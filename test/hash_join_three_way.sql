@@ -0,0 +1,18 @@
+create table planets (id int8, name text, primary key (id));
+insert into planets (id, name) values (1, 'Earth'), (2, 'Mars'), (3, 'Jupiter'), (4, 'Venus');
+
+create table moons (id int8, planet_id int8, name text, primary key (id));
+insert into moons (id, planet_id, name) values (1, 1, 'Luna'), (2, 2, 'Phobos'), (3, 2, 'Deimos'), (4, 3, 'Io'), (5, 3, 'Europa');
+
+create table missions (id int8, moon_id int8, name text, primary key (id));
+insert into missions (id, moon_id, name) values (1, 1, 'Apollo 11'), (2, 1, 'Luna 2'), (3, 2, 'Phobos 2'), (4, 5, 'Europa Clipper');
+
+select p.name, m.name, x.name from planets as p inner join moons as m on p.id = m.planet_id inner join missions as x on m.id = x.moon_id order by x.name asc;
+select '----';
+select p.name, m.name, x.name from planets as p left join moons as m on p.id = m.planet_id left join missions as x on m.id = x.moon_id order by p.name asc, m.name asc, x.name asc;
+select '----';
+select p.name, x.name from planets as p cross join moons as m cross join missions as x where p.id = m.planet_id and m.id = x.moon_id and p.name = 'Earth' order by x.name asc;
+
+drop table planets;
+drop table moons;
+drop table missions;
@@ -0,0 +1,27 @@
+create table readings (value int8, name text, primary key (value));
+insert into readings (value, name) values (5, 'a'), (-1, 'b'), (256, 'c'), (1, 'd'), (-300, 'e');
+select value from readings;
+select '----';
+select value from readings where value > 0;
+select '----';
+select value from readings where value >= -1 and value < 5;
+select '----';
+select value, name from readings where 1 >= value;
+
+create table weights (mass float4, primary key (mass));
+insert into weights (mass) values (1.5), (-2.5), (0.0), (-0.5);
+select '----';
+select mass from weights;
+select '----';
+select mass from weights where mass > -1.0;
+
+create table words (word text, primary key (word));
+insert into words (word) values ('b'), ('ab'), ('a'), ('abc');
+select '----';
+select word from words;
+select '----';
+select word from words where word >= 'ab' and word <= 'abc';
+
+drop table readings;
+drop table weights;
+drop table words;
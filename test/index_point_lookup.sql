@@ -0,0 +1,15 @@
+create table planets (id int8, name text, moons int8, primary key (id), unique (name) nulls distinct);
+insert into planets (id, name, moons) values (1, 'Mercury', 0), (2, 'Venus', 0), (3, 'Earth', 1), (4, 'Mars', 2);
+
+select id, name from planets where id = 3;
+select id, name from planets where name = 'Mars';
+select id, name from planets where 4 = id and name = 'Mars';
+select id, name from planets where id = 2 and moons = 1;
+
+update planets set moons = 3 where name = 'Mars';
+delete from planets where id = 1;
+
+select id, name, moons from planets where id = 4 or id = 1;
+select id, name, moons from planets where name = 'Mercury';
+
+drop table planets;
@@ -0,0 +1,10 @@
+create table planets (id int8, name text, primary key (id), unique(name) nulls not distinct);
+
+insert into planets (id, name) values (1, 'Mercury'), (2, 'Venus'), (1, 'Earth');
+insert into planets (id, name) values (3, 'Mars'), (4, 'Jupiter'), (5, 'Mars');
+insert into planets (id, name) values (3, 'Mars'), (4, 'Jupiter'), (5, 'Saturn');
+insert into planets (id, name) values (6, 'Uranus'), (5, 'Neptune');
+
+select id, name from planets;
+
+drop table planets;
@@ -0,0 +1,15 @@
+create table files (name text, primary key(name));
+insert into files (name) values ('a_b'), ('axb'), ('a%b'), ('50%'), ('500'), ('back\slash');
+select name from files where name like 'a\_b';
+select '----';
+select name from files where name like 'a\%b';
+select '----';
+select name from files where name like '%\%';
+select '----';
+select name from files where name like '%\\%';
+select '----';
+select name from files where name similar to '(a\_b|50\%)';
+select '----';
+select 'a)b' similar to '(a\)b)';
+select 'ab' like 'ab\';
+drop table files;
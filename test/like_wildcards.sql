@@ -0,0 +1,8 @@
+select '' like '%', '' like '_', 'a' like '_', 'ab' like '_';
+select 'banana' like '%an%an%', 'banana' like '%an%an%an%', 'banana' like 'b%a', 'banana' like '_a_a_a';
+select 'aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaab' like '%a%a%a%a%a%a%a%b', 'aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa' like '%a%a%a%a%a%a%a%b';
+select 'Mars' like 'mars', 'Mars' like 'M_rs';
+create table pairs (id int8, str text, pattern text, primary key(id));
+insert into pairs (id, str, pattern) values (1, 'Earth', 'E%'), (2, 'Earth', 'E%'), (3, 'Earth', '%h'), (4, 'Mars', '%h'), (5, 'Mars', '____'), (6, 'Venus', '____'), (7, 'Venus', null), (8, null, '%');
+select id, str like pattern, str similar to pattern from pairs order by id asc;
+drop table pairs;
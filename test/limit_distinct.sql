@@ -0,0 +1,10 @@
+create table pets (id int8, name text, primary key (id));
+insert into pets (id, name) values (1, 'cat'), (2, 'ant'), (3, 'cat'), (4, 'bat');
+
+select distinct name from pets limit 2;
+select '----';
+select id, name from pets where id > 1 limit 2;
+select '----';
+select distinct name from pets limit 0;
+
+drop table pets;
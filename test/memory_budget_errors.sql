@@ -0,0 +1,2 @@
+set memory_budget = 0;
+set work_mem = 1024;
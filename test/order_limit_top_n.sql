@@ -0,0 +1,12 @@
+create table events (id int8, kind text, score int8, primary key (id));
+insert into events (id, kind, score) values (1, 'a', 5), (2, 'b', null), (3, 'a', 9), (4, 'c', 5), (5, 'b', 7), (6, 'a', 1);
+
+select id, score from events order by score desc limit 3;
+select '----';
+select id, score from events order by score asc limit 3;
+select '----';
+select id, score from events order by score asc limit 0;
+select '----';
+select kind, count(id) from events group by kind order by count(id) desc limit 2;
+
+drop table events;
@@ -0,0 +1 @@
+set predict_batch_size = 0;
@@ -0,0 +1,16 @@
+create table digits (id int8, label int8, img bytea, train bool, primary key (id));
+insert into digits (id, label, img, train) values (1, 7, '\xff00ff', true), (2, 3, '\x0102', false), (3, 7, '\x00', true);
+create table labels (label int8, name text, primary key (label));
+insert into labels (label, name) values (3, 'three'), (7, 'seven');
+
+select id from digits where train order by id asc;
+select label from digits order by id desc;
+select d.id, l.name from digits as d inner join labels as l on d.label = l.label order by d.id asc;
+select id, (select name from labels as l where l.label = d.label) from digits as d where not train;
+
+delete from digits where id = 3;
+update digits set label = 1 where id = 2;
+select id, label, img, train from digits order by id asc;
+
+drop table digits;
+drop table labels;
@@ -0,0 +1,15 @@
+create table digits (id int8, label int8, img bytea, unique(img) nulls distinct);
+insert into digits (id, label, img) values (1, 7, '\xff00ff'), (2, 3, '\x0102'), (3, 7, '\x00');
+create table labels (label int8, name text, primary key (label));
+insert into labels (label, name) values (3, 'three'), (7, 'seven');
+
+select id, (select name from labels as l where l.label = d.label) from digits as d order by id asc;
+
+update digits set id = id + 10 where label = (select label from labels where name = 'three');
+delete from digits where label = (select label from labels where name = 'seven') and id = 3;
+insert into digits (id, label, img) values (4, 7, '\x00');
+
+select id, label, img from digits order by id asc;
+
+drop table digits;
+drop table labels;
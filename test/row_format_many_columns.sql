@@ -0,0 +1,8 @@
+create table wide (id int8, a int8, b text, c float4, d bool, e bytea, f int8, g text, h int8, i int8, primary key (id));
+insert into wide (id, a, b, c, d, e, f, g, h, i) values (1, -1, '', 1.5, true, '\x00ff', 300, 'x', null, -9000000000);
+insert into wide (id, a, g, i) values (2, 64, 'y', 0);
+insert into wide (id, i) values (3, -64);
+select id, a, b, c, d, e, f, g, h, i from wide;
+update wide set b = 'long text', h = 127 where id = 3;
+select id, b, h, i from wide where id = 3;
+drop table wide;
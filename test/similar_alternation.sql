@@ -0,0 +1,14 @@
+create table planets (name text, primary key(name));
+insert into planets (name) values ('Earth'), ('Mars'), ('Mercury'), ('Venus'), ('Saturn');
+select name from planets where name similar to 'Mars|Venus';
+select '----';
+select name from planets where name similar to '(Ea|Ma)%';
+select '----';
+select name from planets where name similar to '%(us|ry)';
+select '----';
+select name from planets where name similar to 'M(a|e)r%';
+select '----';
+select 'abcab' similar to '(ab|c)+', 'abcba' similar to '(ab|c)+', 'aabbc' similar to '(a|b)*c', 'c' similar to '(a|b)*c';
+select 'ab' similar to 'ab|';
+select 'ab' similar to 'a()b';
+drop table planets;
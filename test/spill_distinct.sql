@@ -0,0 +1,9 @@
+create table visits (id int8, city text, primary key (id));
+insert into visits (id, city) values (1, 'Paris'), (2, 'Oslo'), (3, 'Lima'), (4, 'Oslo'), (5, 'Paris'), (6, 'Quito'), (7, 'Lima'), (8, 'Oslo'), (9, 'Cairo'), (10, 'Paris');
+
+set memory_budget = 1;
+select distinct city from visits order by city asc;
+select '----';
+select distinct city from visits order by city desc limit 2;
+
+drop table visits;
@@ -0,0 +1,9 @@
+create table sales (id int8, region text, amount int8, primary key (id));
+insert into sales (id, region, amount) values (1, 'north', 10), (2, 'south', 5), (3, 'east', 7), (4, 'west', 3), (5, 'north', 2), (6, 'central', 8), (7, 'south', 1), (8, 'east', 4), (9, 'north', 6), (10, 'west', 9), (11, 'central', 1), (12, 'south', 12);
+
+set memory_budget = 1;
+select region, count(id), sum(amount) from sales group by region order by region asc;
+select '----';
+select region, sum(amount) from sales group by region having sum(amount) > 12 order by region asc;
+
+drop table sales;
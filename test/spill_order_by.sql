@@ -0,0 +1,9 @@
+create table planets (id int8, name text, moons int8, primary key (id));
+insert into planets (id, name, moons) values (1, 'Mercury', 0), (2, 'Venus', 0), (3, 'Earth', 1), (4, 'Mars', 2), (5, 'Jupiter', 95), (6, 'Saturn', 146), (7, 'Uranus', 28), (8, 'Neptune', 16);
+
+set memory_budget = 1;
+select name, moons from planets order by moons desc, name asc;
+select '----';
+select name from planets order by name asc limit 3;
+
+drop table planets;
@@ -0,0 +1,16 @@
+create table planets (id int8, name text, primary key (id));
+insert into planets (id, name) values (1, 'Earth'), (2, 'Mars');
+
+begin;
+insert into planets (id, name) values (3, 'Venus');
+update planets set id = id + 10;
+select id, name from planets;
+select '----';
+delete from planets where id > 11;
+select id, name from planets;
+commit;
+
+select '----';
+select id, name from planets;
+
+drop table planets;